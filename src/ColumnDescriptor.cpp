@@ -0,0 +1,728 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ColumnDescriptor.hpp"
+
+namespace sqlfileparser
+{
+
+namespace
+{
+
+struct TypeName {
+	const char* name;
+	ColumnType type;
+};
+
+const TypeName typeNames[] = {
+	{ "tinyint", TINYINT_TYPE }, { "bool", TINYINT_TYPE }, { "boolean", TINYINT_TYPE }, { "int1", TINYINT_TYPE },
+	{ "smallint", SMALLINT_TYPE }, { "int2", SMALLINT_TYPE },
+	{ "mediumint", MEDIUMINT_TYPE }, { "middleint", MEDIUMINT_TYPE }, { "int3", MEDIUMINT_TYPE },
+	{ "int", INT_TYPE }, { "integer", INT_TYPE }, { "int4", INT_TYPE },
+	{ "bigint", BIGINT_TYPE }, { "int8", BIGINT_TYPE },
+	{ "decimal", DECIMAL_TYPE }, { "dec", DECIMAL_TYPE }, { "numeric", DECIMAL_TYPE }, { "fixed", DECIMAL_TYPE },
+	{ "float", FLOAT_TYPE }, { "float4", FLOAT_TYPE },
+	{ "double", DOUBLE_TYPE }, { "real", DOUBLE_TYPE }, { "float8", DOUBLE_TYPE },
+	{ "bit", BIT_TYPE },
+	{ "char", CHAR_TYPE }, { "character", CHAR_TYPE }, { "nchar", CHAR_TYPE },
+	{ "varchar", VARCHAR_TYPE }, { "nvarchar", VARCHAR_TYPE },
+	{ "binary", BINARY_TYPE }, { "varbinary", VARBINARY_TYPE },
+	{ "tinytext", TINYTEXT_TYPE }, { "text", TEXT_TYPE }, { "mediumtext", MEDIUMTEXT_TYPE }, { "longtext", LONGTEXT_TYPE },
+	{ "tinyblob", TINYBLOB_TYPE }, { "blob", BLOB_TYPE }, { "mediumblob", MEDIUMBLOB_TYPE }, { "longblob", LONGBLOB_TYPE },
+	{ "enum", ENUM_TYPE }, { "set", SET_TYPE },
+	{ "date", DATE_TYPE }, { "time", TIME_TYPE }, { "datetime", DATETIME_TYPE }, { "timestamp", TIMESTAMP_TYPE },
+	{ "year", YEAR_TYPE }, { "json", JSON_TYPE }
+};
+
+ColumnType
+findType(std::string_view name)
+{
+	for (std::size_t i = 0 ; i < sizeof(typeNames) / sizeof(typeNames[0]) ; ++i)
+	{
+		if (name == typeNames[i].name)
+		{
+			return typeNames[i].type;
+		}
+	}
+
+	return OTHER_TYPE;
+}
+
+bool
+isInteger(ColumnType type)
+{
+	return type >= TINYINT_TYPE && type <= BIGINT_TYPE;
+}
+
+bool
+isNumeric(ColumnType type)
+{
+	return type >= TINYINT_TYPE && type <= DOUBLE_TYPE;
+}
+
+/* the types that have a charset and a collation
+*/
+
+bool
+isText(ColumnType type)
+{
+	return type == CHAR_TYPE || type == VARCHAR_TYPE || (type >= TINYTEXT_TYPE && type <= LONGTEXT_TYPE) ||
+		type == ENUM_TYPE || type == SET_TYPE;
+}
+
+bool
+isBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool
+isQuote(char c)
+{
+	return c == '\'' || c == '"';
+}
+
+/* past the closing quote; a backslash or a doubled quote doesn't close
+*/
+
+std::size_t
+skipQuoted(std::string_view str, std::size_t i)
+{
+	const char quote = str[i++];
+
+	while (i < str.size())
+	{
+		if (str[i] == '\\' && i + 1 < str.size())
+		{
+			i += 2;
+		}
+		else if (str[i] == quote && i + 1 < str.size() && str[i + 1] == quote)
+		{
+			i += 2;
+		}
+		else if (str[i] == quote)
+		{
+			return i + 1;
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	return i;
+}
+
+/* words, quoted strings and parenthesized groups, the way the lexer spaced
+   them
+*/
+
+std::vector<std::string_view>
+tokenize(std::string_view def)
+{
+	std::vector<std::string_view> tokens;
+	std::size_t i = 0;
+
+	while (i < def.size())
+	{
+		const std::size_t start = i;
+
+		if (isBlank(def[i]))
+		{
+			++i;
+			continue;
+		}
+
+		if (isQuote(def[i]))
+		{
+			i = skipQuoted(def, i);
+		}
+		else if (def[i] == '(')
+		{
+			int depth = 0;
+
+			while (i < def.size())
+			{
+				if (isQuote(def[i]))
+				{
+					i = skipQuoted(def, i);
+					continue;
+				}
+
+				if (def[i] == '(')
+				{
+					++depth;
+				}
+				else if (def[i] == ')' && --depth == 0)
+				{
+					++i;
+					break;
+				}
+
+				++i;
+			}
+		}
+		else
+		{
+			while (i < def.size() && !isBlank(def[i]) && def[i] != '(' && !isQuote(def[i]))
+			{
+				++i;
+			}
+		}
+
+		tokens.push_back(def.substr(start, i - start));
+	}
+
+	return tokens;
+}
+
+bool
+isQuoted(std::string_view token)
+{
+	return token.size() >= 2 && isQuote(token[0]) && token.back() == token[0];
+}
+
+bool
+isGroup(std::string_view token)
+{
+	return !token.empty() && token[0] == '(';
+}
+
+/* 'it''s' and "it's" both become 'it''s'
+*/
+
+std::string
+canonicalQuoted(std::string_view token)
+{
+	const char quote = token[0];
+	std::string result("'");
+
+	for (std::size_t i = 1 ; i + 1 < token.size() ; ++i)
+	{
+		if (token[i] == '\\' && i + 2 < token.size())
+		{
+			result += token[i];
+			result += token[++i];
+		}
+		else if (token[i] == quote && token[i + 1] == quote && i + 2 < token.size())
+		{
+			result += (quote == '\'') ? "''" : "\"";
+			++i;
+		}
+		else if (token[i] == '\'')
+		{
+			result += "''";
+		}
+		else
+		{
+			result += token[i];
+		}
+	}
+
+	return result + "'";
+}
+
+/* a plain decimal number without the noise: +1.50 is 1.5, 000 is 0, -0.0 is 0;
+   false for anything else (exponents included)
+*/
+
+bool
+canonicalNumber(std::string_view str, std::string& number)
+{
+	std::size_t i = 0;
+	bool negative = false;
+
+	if (i < str.size() && (str[i] == '+' || str[i] == '-'))
+	{
+		negative = (str[i++] == '-');
+	}
+
+	std::string_view::size_type intStart = i;
+	while (i < str.size() && str[i] >= '0' && str[i] <= '9') ++i;
+	std::string_view intPart(str.substr(intStart, i - intStart));
+
+	std::string_view fracPart;
+	if (i < str.size() && str[i] == '.')
+	{
+		std::string_view::size_type fracStart = ++i;
+		while (i < str.size() && str[i] >= '0' && str[i] <= '9') ++i;
+		fracPart = str.substr(fracStart, i - fracStart);
+	}
+
+	if (i != str.size() || (intPart.empty() && fracPart.empty()))
+	{
+		return false;
+	}
+
+	while (intPart.size() > 1 && intPart[0] == '0') intPart.remove_prefix(1);
+	while (!fracPart.empty() && fracPart.back() == '0') fracPart.remove_suffix(1);
+
+	if (intPart.empty())
+	{
+		intPart = "0";
+	}
+
+	number.clear();
+	if (negative && !(intPart == "0" && fracPart.empty()))
+	{
+		number += '-';
+	}
+	number.append(intPart);
+	if (!fracPart.empty())
+	{
+		number += '.';
+		number.append(fracPart);
+	}
+
+	return true;
+}
+
+/* the numbers of a "(10,2)" group, -1 for the missing ones
+*/
+
+int
+groupArguments(std::string_view group, int& first, int& second)
+{
+	first = second = -1;
+
+	std::string inner(group.substr(1, group.size() - 2));
+	int count = 0;
+
+	for (std::string::size_type from = 0 ; from <= inner.size() ; ++count)
+	{
+		std::string::size_type comma = inner.find(',', from);
+		if (comma == std::string::npos)
+		{
+			comma = inner.size();
+		}
+
+		const std::string arg(inner.substr(from, comma - from));
+		char* end = 0;
+		const long value = std::strtol(arg.c_str(), &end, 10);
+
+		if (!arg.empty() && *end == 0)
+		{
+			(count == 0 ? first : second) = static_cast<int>(value);
+		}
+
+		from = comma + 1;
+	}
+
+	return count;
+}
+
+/* the enum / set values, quoted the same way and without blanks between them
+*/
+
+std::string
+canonicalValues(std::string_view group)
+{
+	std::string values;
+	std::string_view inner(group.substr(1, group.size() - 2));
+
+	for (std::size_t i = 0 ; i < inner.size() ; )
+	{
+		if (isBlank(inner[i]) || inner[i] == ',')
+		{
+			++i;
+			continue;
+		}
+
+		std::size_t end = i;
+		if (isQuote(inner[i]))
+		{
+			end = skipQuoted(inner, i);
+		}
+		else
+		{
+			while (end < inner.size() && inner[end] != ',') ++end;
+		}
+
+		if (!values.empty())
+		{
+			values += ',';
+		}
+
+		std::string_view value(inner.substr(i, end - i));
+		values += isQuoted(value) ? canonicalQuoted(value) : std::string(value);
+
+		i = end;
+	}
+
+	return values;
+}
+
+/* utf8 is utf8mb3, whichever way it is written
+*/
+
+std::string
+canonicalCharset(std::string_view name)
+{
+	std::string result(name);
+
+	if (result.compare(0, 7, "utf8mb3") == 0)
+	{
+		result.erase(4, 3);
+	}
+
+	return result;
+}
+
+bool
+isCurrentTimestamp(std::string_view word)
+{
+	return word == "current_timestamp" || word == "now" || word == "localtime" || word == "localtimestamp";
+}
+
+/* the value of "default" or "on update" starting at tokens[j]; j is left on
+   its last token
+*/
+
+std::string
+canonicalValue(ColumnType type, const std::vector<std::string_view>& tokens, std::size_t& j)
+{
+	const std::string_view token = tokens[j];
+	std::string_view group;
+
+	if (j + 1 < tokens.size() && isGroup(tokens[j + 1]) && !isQuoted(token) && !isGroup(token))
+	{
+		group = tokens[++j];
+	}
+
+	if (isCurrentTimestamp(token))
+	{
+		int fsp, ignored;
+		if (group.empty() || groupArguments(group, fsp, ignored) != 1 || fsp <= 0)
+		{
+			return "current_timestamp";
+		}
+
+		return "current_timestamp(" + std::to_string(fsp) + ")";
+	}
+
+	std::string number;
+
+	if (isQuoted(token))
+	{
+		if (isNumeric(type) && canonicalNumber(token.substr(1, token.size() - 2), number))
+		{
+			return number;
+		}
+
+		return canonicalQuoted(token);
+	}
+
+	if (isNumeric(type) && canonicalNumber(token, number))
+	{
+		return number;
+	}
+
+	return std::string(token) + std::string(group);
+}
+
+} // anonymous namespace
+
+ColumnDescriptor::ColumnDescriptor()
+:type(OTHER_TYPE),
+typeName(),
+length(-1),
+scale(-1),
+isUnsigned(false),
+zerofill(false),
+nullable(true),
+autoIncrement(false),
+hasDefault(false),
+defaultValue(),
+onUpdate(),
+charset(),
+collation(),
+comment(),
+values(),
+rest()
+{
+}
+
+bool
+ColumnDescriptor::operator==(const ColumnDescriptor& other) const
+{
+	return type == other.type && typeName == other.typeName &&
+		length == other.length && scale == other.scale &&
+		isUnsigned == other.isUnsigned && zerofill == other.zerofill &&
+		nullable == other.nullable && autoIncrement == other.autoIncrement &&
+		hasDefault == other.hasDefault && defaultValue == other.defaultValue && onUpdate == other.onUpdate &&
+		charset == other.charset && collation == other.collation &&
+		comment == other.comment && values == other.values && rest == other.rest;
+}
+
+/* "default charset=utf8mb4 collate=utf8mb4_bin", "character set = latin1"...
+*/
+
+TableCharset
+describeTableCharset(const Atom& tabletype, StringPool& pool)
+{
+	std::string options;
+
+	for (std::string::const_iterator it = tabletype.str().begin() ; it != tabletype.str().end() ; ++it)
+	{
+		if (isBlank(*it) && ((it + 1 != tabletype.str().end() && *(it + 1) == '=') || (!options.empty() && options.back() == '=')))
+		{
+			continue;
+		}
+		options += *it;
+	}
+
+	const std::vector<std::string_view> tokens(tokenize(options));
+	std::string charset, collation;
+
+	for (std::size_t i = 0 ; i < tokens.size() ; ++i)
+	{
+		std::string_view token(tokens[i]);
+
+		if ((token == "character" || token == "char") && i + 1 < tokens.size() && tokens[i + 1].compare(0, 4, "set=") == 0)
+		{
+			charset = canonicalCharset(tokens[++i].substr(4));
+		}
+		else if (token.compare(0, 8, "charset=") == 0)
+		{
+			charset = canonicalCharset(token.substr(8));
+		}
+		else if (token.compare(0, 8, "collate=") == 0)
+		{
+			collation = canonicalCharset(token.substr(8));
+		}
+	}
+
+	if (charset.empty() && !collation.empty())
+	{
+		charset = collation.substr(0, collation.find('_'));
+	}
+
+	TableCharset result;
+	result.charset = pool.intern(charset);
+	result.collation = pool.intern(collation);
+
+	return result;
+}
+
+ColumnDescriptor
+describeColumn(const Atom& definition, const TableCharset& defaults, StringPool& pool)
+{
+	const std::vector<std::string_view> tokens(tokenize(definition.str()));
+	ColumnDescriptor column;
+
+	std::size_t j = 0;
+	bool national = false;
+
+	if (j < tokens.size() && tokens[j] == "national")
+	{
+		national = true;
+		++j;
+	}
+
+/* the type, in one word or two, and its arguments
+*/
+
+	if (j < tokens.size())
+	{
+		const std::string_view name(tokens[j++]);
+		column.type = findType(name);
+		national = national || name == "nchar" || name == "nvarchar";
+
+		if (column.type == OTHER_TYPE)
+		{
+			column.typeName = pool.intern(name);
+		}
+		else if (j < tokens.size() && name == "double" && tokens[j] == "precision")
+		{
+			++j;
+		}
+		else if (j < tokens.size() && column.type == CHAR_TYPE && tokens[j] == "varying")
+		{
+			column.type = VARCHAR_TYPE;
+			++j;
+		}
+	}
+
+	if (j < tokens.size() && isGroup(tokens[j]))
+	{
+		const std::string_view group(tokens[j++]);
+
+		if (column.type == ENUM_TYPE || column.type == SET_TYPE)
+		{
+			column.values = pool.intern(canonicalValues(group));
+		}
+		else if (column.type == OTHER_TYPE)
+		{
+			column.typeName = pool.intern(column.typeName.str() + std::string(group));
+		}
+		else if (groupArguments(group, column.length, column.scale) == 1 && column.type == FLOAT_TYPE)
+		{
+
+/* float(p) is a float up to 24 bits of precision, a double above
+*/
+
+			column.type = (column.length > 24) ? DOUBLE_TYPE : FLOAT_TYPE;
+			column.length = -1;
+		}
+	}
+
+/* the attributes, in whatever order
+*/
+
+	std::string rest, charset, collation;
+	bool explicitCharset = false, explicitCollation = false;
+
+	for ( ; j < tokens.size() ; ++j)
+	{
+		const std::string_view token(tokens[j]);
+		const bool hasNext = j + 1 < tokens.size();
+
+		if (token == "unsigned")
+		{
+			column.isUnsigned = true;
+		}
+		else if (token == "signed")
+		{
+		}
+		else if (token == "zerofill")
+		{
+			column.zerofill = column.isUnsigned = true;
+		}
+		else if (token == "not" && hasNext && tokens[j + 1] == "null")
+		{
+			column.nullable = false;
+			++j;
+		}
+		else if (token == "null")
+		{
+			column.nullable = true;
+		}
+		else if (token == "auto_increment")
+		{
+			column.autoIncrement = true;
+		}
+		else if (token == "default" && hasNext)
+		{
+			column.hasDefault = true;
+			column.defaultValue = pool.intern(canonicalValue(column.type, tokens, ++j));
+		}
+		else if (token == "on" && hasNext && tokens[j + 1] == "update" && j + 2 < tokens.size())
+		{
+			j += 2;
+			column.onUpdate = pool.intern(canonicalValue(column.type, tokens, j));
+		}
+		else if ((token == "character" || token == "char") && hasNext && tokens[j + 1] == "set" && j + 2 < tokens.size())
+		{
+			charset = canonicalCharset(tokens[j + 2]);
+			explicitCharset = true;
+			j += 2;
+		}
+		else if (token == "charset" && hasNext)
+		{
+			charset = canonicalCharset(tokens[++j]);
+			explicitCharset = true;
+		}
+		else if (token == "collate" && hasNext)
+		{
+			collation = canonicalCharset(tokens[++j]);
+			explicitCollation = true;
+		}
+		else if (token == "comment" && hasNext && isQuoted(tokens[j + 1]))
+		{
+			column.comment = pool.intern(canonicalQuoted(tokens[++j]));
+		}
+		else
+		{
+			if (!rest.empty())
+			{
+				rest += ' ';
+			}
+			rest.append(token);
+		}
+	}
+
+	column.rest = pool.intern(rest);
+
+/* the lengths MySQL implies, or ignores
+*/
+
+	if (isInteger(column.type) && !column.zerofill)
+	{
+		column.length = -1;
+	}
+
+	switch (column.type)
+	{
+		case DECIMAL_TYPE:
+			column.length = (column.length < 0) ? 10 : column.length;
+			column.scale = (column.scale < 0) ? 0 : column.scale;
+			break;
+
+		case BIT_TYPE:
+		case CHAR_TYPE:
+		case BINARY_TYPE:
+			column.length = (column.length < 0) ? 1 : column.length;
+			break;
+
+		case TIME_TYPE:
+		case DATETIME_TYPE:
+		case TIMESTAMP_TYPE:
+			column.length = (column.length < 0) ? 0 : column.length;
+			break;
+
+		case YEAR_TYPE:
+		case TINYTEXT_TYPE:
+		case TEXT_TYPE:
+		case MEDIUMTEXT_TYPE:
+		case LONGTEXT_TYPE:
+		case TINYBLOB_TYPE:
+		case BLOB_TYPE:
+		case MEDIUMBLOB_TYPE:
+		case LONGBLOB_TYPE:
+			column.length = -1;
+			break;
+
+		default:
+			break;
+	}
+
+/* a charset or a collation of its own, or else the table's; a charset of
+   its own without a collation gets the default collation of that charset,
+   which we don't know (left empty)
+*/
+
+	if (isText(column.type))
+	{
+		if (national && !explicitCharset)
+		{
+			charset = "utf8";
+			explicitCharset = true;
+		}
+
+		if (!explicitCharset && !explicitCollation)
+		{
+			column.charset = defaults.charset;
+			column.collation = defaults.collation;
+		}
+		else
+		{
+			if (!explicitCharset)
+			{
+				charset = collation.substr(0, collation.find('_'));
+			}
+
+			column.charset = pool.intern(charset);
+			column.collation = pool.intern(collation);
+		}
+	}
+
+	return column;
+}
+
+} //namespace
@@ -0,0 +1,109 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef COLUMNDESCRIPTOR_HPP
+#define COLUMNDESCRIPTOR_HPP
+
+#include "StringPool.hpp"
+
+namespace sqlfileparser
+{
+
+/* the column types, synonyms folded (integer is int, boolean is tinyint,
+   numeric is decimal...); OTHER_TYPE keeps its name in typeName
+*/
+
+enum ColumnType {
+	OTHER_TYPE = 0,
+	TINYINT_TYPE,
+	SMALLINT_TYPE,
+	MEDIUMINT_TYPE,
+	INT_TYPE,
+	BIGINT_TYPE,
+	DECIMAL_TYPE,
+	FLOAT_TYPE,
+	DOUBLE_TYPE,
+	BIT_TYPE,
+	CHAR_TYPE,
+	VARCHAR_TYPE,
+	BINARY_TYPE,
+	VARBINARY_TYPE,
+	TINYTEXT_TYPE,
+	TEXT_TYPE,
+	MEDIUMTEXT_TYPE,
+	LONGTEXT_TYPE,
+	TINYBLOB_TYPE,
+	BLOB_TYPE,
+	MEDIUMBLOB_TYPE,
+	LONGBLOB_TYPE,
+	ENUM_TYPE,
+	SET_TYPE,
+	DATE_TYPE,
+	TIME_TYPE,
+	DATETIME_TYPE,
+	TIMESTAMP_TYPE,
+	YEAR_TYPE,
+	JSON_TYPE
+};
+
+/* the charset and collation a column gets when it doesn't name its own: the
+   table options; empty when the table doesn't say
+*/
+
+struct TableCharset {
+	Atom charset, collation;
+};
+
+/* a column definition (as the lexer wrote it: "varchar (100) default 'a' not
+   null") taken apart, with everything MySQL treats as the same written the
+   same way: the integer display widths, the implied lengths and precisions
+   (char is char(1), decimal is decimal(10,0)), quoted numeric defaults
+   ('0.00' is 0), the current_timestamp synonyms, the charset and collation
+   inherited from the table. Two columns are the same when their descriptors
+   are; every text member is interned, so comparing is comparing integers.
+*/
+
+struct ColumnDescriptor {
+
+	ColumnDescriptor();
+
+	bool operator==(const ColumnDescriptor& other) const;
+
+	bool operator!=(const ColumnDescriptor& other) const { return !(*this == other); }
+
+	ColumnType type;
+
+	Atom typeName;
+
+/* -1 when there is none
+*/
+
+	int length, scale;
+
+	bool isUnsigned, zerofill, nullable, autoIncrement, hasDefault;
+
+	Atom defaultValue, onUpdate;
+
+	Atom charset, collation;
+
+	Atom comment;
+
+/* the enum / set values
+*/
+
+	Atom values;
+
+/* the words we don't know about, in order
+*/
+
+	Atom rest;
+};
+
+	TableCharset describeTableCharset(const Atom& tabletype, StringPool& pool);
+
+	ColumnDescriptor describeColumn(const Atom& definition, const TableCharset& defaults, StringPool& pool);
+
+} // namespace
+
+#endif
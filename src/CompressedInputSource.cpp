@@ -0,0 +1,501 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "configure.h"
+#endif
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+#include "CompressedInputSource.hpp"
+
+namespace sqlfileparser
+{
+
+/* the size of the decompressed blocks and how many of them may be in flight
+*/
+
+static const std::size_t DECOMPRESSED_BLOCK_SIZE = 1 << 20;
+
+static const std::size_t DECOMPRESSED_BLOCK_COUNT = 4;
+
+/* the size of the reads from the compressed file
+*/
+
+static const std::size_t COMPRESSED_READ_SIZE = 256 << 10;
+
+namespace
+{
+
+bool
+endsWith(const std::string& str, const std::string& suffix)
+{
+	return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // anonymous namespace
+
+/* turns the compressed file into plain text, one buffer at a time; read() only
+   returns less than asked for at the end of the data
+*/
+
+class Decompressor
+{
+	public:
+
+		Decompressor(const std::string& fname);
+
+		virtual ~Decompressor() {}
+
+		virtual std::size_t read(char* out, std::size_t size) = 0;
+
+	protected:
+
+		bool refill();
+
+		void truncated() const;
+
+		std::string fname_;
+
+		std::ifstream file_;
+
+		std::vector<char> in_;
+
+		std::size_t inSize_;
+};
+
+Decompressor::Decompressor(const std::string& fname)
+:fname_(fname),
+file_(fname.c_str(), std::ios::in | std::ios::binary),
+in_(COMPRESSED_READ_SIZE),
+inSize_(0)
+{
+	if (!file_.good())
+	{
+		throw std::runtime_error("cannot open file " + fname + " for reading.");
+	}
+}
+
+bool
+Decompressor::refill()
+{
+	if (!file_.good())
+	{
+		return false;
+	}
+
+	file_.read(&in_[0], in_.size());
+	inSize_ = file_.gcount();
+
+	return inSize_ > 0;
+}
+
+void
+Decompressor::truncated() const
+{
+	throw std::runtime_error("unexpected end of compressed file " + fname_ + ".");
+}
+
+namespace
+{
+
+#ifdef HAVE_ZLIB
+
+class GzipDecompressor : public Decompressor
+{
+	public:
+
+		GzipDecompressor(const std::string& fname)
+		:Decompressor(fname),
+		memberEnd_(false)
+		{
+			std::memset(&zs_, 0, sizeof(zs_));
+
+/* 15 + 32: the largest window, with gzip/zlib header autodetection
+*/
+
+			if (inflateInit2(&zs_, 15 + 32) != Z_OK)
+			{
+				throw std::runtime_error("cannot initialize zlib for " + fname + ".");
+			}
+		}
+
+		~GzipDecompressor()
+		{
+			inflateEnd(&zs_);
+		}
+
+		std::size_t read(char* out, std::size_t size)
+		{
+			zs_.next_out = reinterpret_cast<Bytef*>(out);
+			zs_.avail_out = size;
+
+			while (zs_.avail_out > 0)
+			{
+				if (zs_.avail_in == 0)
+				{
+					if (!refill())
+					{
+						if (!memberEnd_) truncated();
+						break;
+					}
+					zs_.next_in = reinterpret_cast<Bytef*>(&in_[0]);
+					zs_.avail_in = inSize_;
+				}
+
+/* gzip files may be a concatenation of several members (pigz, cat a.gz b.gz)
+*/
+
+				if (memberEnd_)
+				{
+					inflateReset(&zs_);
+					memberEnd_ = false;
+				}
+
+				int ret = inflate(&zs_, Z_NO_FLUSH);
+				if (ret == Z_STREAM_END)
+				{
+					memberEnd_ = true;
+				}
+				else if (ret != Z_OK)
+				{
+					throw std::runtime_error("corrupt gzip data in " + fname_ + ".");
+				}
+			}
+
+			return size - zs_.avail_out;
+		}
+
+	private:
+
+		z_stream zs_;
+
+		bool memberEnd_;
+};
+
+#endif
+
+#ifdef HAVE_ZSTD
+
+class ZstdDecompressor : public Decompressor
+{
+	public:
+
+		ZstdDecompressor(const std::string& fname)
+		:Decompressor(fname),
+		dctx_(ZSTD_createDCtx()),
+		inPos_(0),
+		frameEnd_(true)
+		{
+			if (dctx_ == 0)
+			{
+				throw std::runtime_error("cannot initialize zstd for " + fname + ".");
+			}
+		}
+
+		~ZstdDecompressor()
+		{
+			ZSTD_freeDCtx(dctx_);
+		}
+
+		std::size_t read(char* out, std::size_t size)
+		{
+			ZSTD_outBuffer obuf = { out, size, 0 };
+
+			while (obuf.pos < obuf.size)
+			{
+				if (inPos_ == inSize_)
+				{
+					if (!refill())
+					{
+						if (!frameEnd_) truncated();
+						break;
+					}
+					inPos_ = 0;
+				}
+
+				ZSTD_inBuffer ibuf = { &in_[0], inSize_, inPos_ };
+				std::size_t ret = ZSTD_decompressStream(dctx_, &obuf, &ibuf);
+				if (ZSTD_isError(ret))
+				{
+					throw std::runtime_error("corrupt zstd data in " + fname_ + ": " + ZSTD_getErrorName(ret));
+				}
+				inPos_ = ibuf.pos;
+				frameEnd_ = (ret == 0);
+			}
+
+			return obuf.pos;
+		}
+
+	private:
+
+		ZSTD_DCtx* dctx_;
+
+		std::size_t inPos_;
+
+		bool frameEnd_;
+};
+
+#endif
+
+#ifdef HAVE_LZMA
+
+class XzDecompressor : public Decompressor
+{
+	public:
+
+		XzDecompressor(const std::string& fname)
+		:Decompressor(fname),
+		strm_(LZMA_STREAM_INIT),
+		eof_(false),
+		streamEnd_(false)
+		{
+			if (lzma_stream_decoder(&strm_, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+			{
+				throw std::runtime_error("cannot initialize liblzma for " + fname + ".");
+			}
+		}
+
+		~XzDecompressor()
+		{
+			lzma_end(&strm_);
+		}
+
+		std::size_t read(char* out, std::size_t size)
+		{
+			strm_.next_out = reinterpret_cast<uint8_t*>(out);
+			strm_.avail_out = size;
+
+			while (strm_.avail_out > 0 && !streamEnd_)
+			{
+				if (strm_.avail_in == 0 && !eof_)
+				{
+					if (refill())
+					{
+						strm_.next_in = reinterpret_cast<const uint8_t*>(&in_[0]);
+						strm_.avail_in = inSize_;
+					}
+					else
+					{
+						eof_ = true;
+					}
+				}
+
+/* LZMA_CONCATENATED needs LZMA_FINISH to tell the end of the file from a pause
+*/
+
+				lzma_ret ret = lzma_code(&strm_, eof_ ? LZMA_FINISH : LZMA_RUN);
+				if (ret == LZMA_STREAM_END)
+				{
+					streamEnd_ = true;
+				}
+				else if (ret == LZMA_BUF_ERROR && eof_)
+				{
+					truncated();
+				}
+				else if (ret != LZMA_OK)
+				{
+					throw std::runtime_error("corrupt xz data in " + fname_ + ".");
+				}
+			}
+
+			return size - strm_.avail_out;
+		}
+
+	private:
+
+		lzma_stream strm_;
+
+		bool eof_;
+
+		bool streamEnd_;
+};
+
+#endif
+
+Decompressor*
+createDecompressor(const std::string& fname)
+{
+	if (endsWith(fname, ".gz"))
+	{
+#ifdef HAVE_ZLIB
+		return new GzipDecompressor(fname);
+#else
+		throw std::runtime_error("cannot read " + fname + ": built without gzip support.");
+#endif
+	}
+
+	if (endsWith(fname, ".zst"))
+	{
+#ifdef HAVE_ZSTD
+		return new ZstdDecompressor(fname);
+#else
+		throw std::runtime_error("cannot read " + fname + ": built without zstd support.");
+#endif
+	}
+
+	if (endsWith(fname, ".xz"))
+	{
+#ifdef HAVE_LZMA
+		return new XzDecompressor(fname);
+#else
+		throw std::runtime_error("cannot read " + fname + ": built without xz support.");
+#endif
+	}
+
+	throw std::logic_error("createDecompressor() called on an uncompressed file!");
+}
+
+} // anonymous namespace
+
+CompressedInputSource::CompressedInputSource(const std::string& fname)
+:decompressor_(createDecompressor(fname)),
+blocks_(DECOMPRESSED_BLOCK_COUNT),
+free_(),
+full_(),
+current_(0),
+hasCurrent_(false),
+finished_(false),
+stop_(false),
+error_(),
+mutex_(),
+cond_(),
+thread_()
+{
+	for (std::size_t i = 0 ; i < blocks_.size() ; ++i)
+	{
+		blocks_[i].data.resize(DECOMPRESSED_BLOCK_SIZE);
+		blocks_[i].size = 0;
+		free_.push_back(i);
+	}
+
+	thread_ = std::thread(&CompressedInputSource::run, this);
+}
+
+CompressedInputSource::~CompressedInputSource()
+{
+/* the lexer may give up early (parse error); wake the decompressor and wait for it
+*/
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	cond_.notify_all();
+
+	thread_.join();
+}
+
+void
+CompressedInputSource::run()
+{
+	try
+	{
+		for (;;)
+		{
+			std::size_t idx;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				cond_.wait(lock, [this] { return stop_ || !free_.empty(); });
+				if (stop_)
+				{
+					return;
+				}
+				idx = free_.front();
+				free_.pop_front();
+			}
+
+			Block& block = blocks_[idx];
+			block.size = decompressor_->read(&block.data[0], block.data.size());
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (block.size == 0)
+				{
+					free_.push_back(idx);
+					finished_ = true;
+				}
+				else
+				{
+					full_.push_back(idx);
+				}
+			}
+			cond_.notify_all();
+
+			if (block.size == 0)
+			{
+				return;
+			}
+		}
+	}
+	catch(...)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			error_ = std::current_exception();
+			finished_ = true;
+		}
+		cond_.notify_all();
+	}
+}
+
+bool
+CompressedInputSource::next(const char*& begin, const char*& end)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+
+/* the block handed out by the previous call goes back to the decompressor
+*/
+
+	if (hasCurrent_)
+	{
+		free_.push_back(current_);
+		hasCurrent_ = false;
+		cond_.notify_all();
+	}
+
+	cond_.wait(lock, [this] { return finished_ || !full_.empty(); });
+
+	if (!full_.empty())
+	{
+		current_ = full_.front();
+		full_.pop_front();
+		hasCurrent_ = true;
+
+		begin = &blocks_[current_].data[0];
+		end = begin + blocks_[current_].size;
+
+		return true;
+	}
+
+	if (error_)
+	{
+		std::rethrow_exception(error_);
+	}
+
+	return false;
+}
+
+bool
+CompressedInputSource::isCompressed(const std::string& fname)
+{
+	return endsWith(fname, ".gz") || endsWith(fname, ".zst") || endsWith(fname, ".xz");
+}
+
+} //namespace
@@ -0,0 +1,85 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef COMPRESSEDINPUTSOURCE_HPP
+#define COMPRESSEDINPUTSOURCE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "InputSource.hpp"
+
+namespace sqlfileparser
+{
+
+class Decompressor;
+
+/* a .gz, .zst or .xz dump decompressed on its own thread; the decompressed data
+   goes to the lexer through a bounded ring of blocks, so the two sides only wait
+   on each other when the ring is full or empty
+*/
+
+class CompressedInputSource : public InputSource
+{
+	public:
+
+		CompressedInputSource(const std::string& fname);
+
+		~CompressedInputSource();
+
+		bool next(const char*& begin, const char*& end);
+
+/* true if the file name ends in one of the extensions we know how to decompress
+*/
+
+		static bool isCompressed(const std::string& fname);
+
+	private:
+
+		CompressedInputSource(const CompressedInputSource&);
+
+		CompressedInputSource& operator=(const CompressedInputSource&);
+
+		struct Block {
+			std::vector<char> data;
+			std::size_t size;
+		};
+
+		void run();
+
+		std::unique_ptr<Decompressor> decompressor_;
+
+		std::vector<Block> blocks_;
+
+/* block indexes: the ones waiting to be filled and the ones waiting to be scanned
+*/
+
+		std::deque<std::size_t> free_, full_;
+
+		std::size_t current_;
+
+		bool hasCurrent_;
+
+		bool finished_;
+
+		bool stop_;
+
+		std::exception_ptr error_;
+
+		std::mutex mutex_;
+
+		std::condition_variable cond_;
+
+		std::thread thread_;
+};
+
+} // namespace
+
+#endif
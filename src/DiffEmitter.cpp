@@ -0,0 +1,746 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <algorithm>
+#include <cstdio>
+
+#include "DiffEmitter.hpp"
+#include "OnlineDDL.hpp"
+
+namespace sqlfileparser
+{
+
+namespace
+{
+
+/* the column a column goes after in "ref", none if it goes first
+*/
+
+const Atom*
+predecessor(const SQLTable& ref, const Atom& field)
+{
+	std::size_t pos = ref.position(field);
+
+	return (pos == 0 || pos == SQLTable::NOPOSITION) ? 0 : &ref.fields[pos - 1];
+}
+
+std::string
+placement(const SQLTable& ref, const Atom& field)
+{
+	const Atom* previous = predecessor(ref, field);
+
+	return (previous == 0) ? std::string("first") : "after " + *previous;
+}
+
+const char*
+opName(DiffOpKind kind)
+{
+	static const char* names[] = {
+		"create_table", "drop_table", "rename_table",
+		"add_column", "modify_column", "move_column", "rename_column", "drop_column",
+		"drop_primary", "add_primary", "drop_foreign", "add_foreign",
+		"drop_index", "add_index", "drop_unique", "add_unique",
+		"drop_fulltext", "add_fulltext", "drop_spatial", "add_spatial"
+	};
+
+	return names[kind];
+}
+
+/* instant takes no lock worth naming
+*/
+
+std::string
+ddlClause(const OnlineDDL& ddl)
+{
+	if (ddl.algorithm == INSTANT_ALGORITHM)
+	{
+		return "algorithm=instant";
+	}
+
+	return "algorithm=" + std::string(ddl.algorithmName()) + ", lock=" + ddl.lockName();
+}
+
+} // anonymous namespace
+
+DiffEmitter::DiffEmitter(OutputSink& out)
+:out_(out)
+{
+}
+
+DiffEmitter::~DiffEmitter()
+{
+}
+
+void
+DiffEmitter::begin()
+{
+}
+
+void
+DiffEmitter::end()
+{
+}
+
+std::unique_ptr<DiffEmitter>
+DiffEmitter::part(OutputSink&) const
+{
+	return std::unique_ptr<DiffEmitter>();
+}
+
+void
+DiffEmitter::flush()
+{
+}
+
+void
+DiffEmitter::join(DiffEmitter&, const std::string& text)
+{
+	out_ << text;
+}
+
+
+/* mysql */
+
+SQLEmitter::SQLEmitter(OutputSink& out, bool skipColumnMoves, bool singleAlter, bool onlineDDL)
+:DiffEmitter(out),
+skipColumnMoves_(skipColumnMoves),
+singleAlter_(singleAlter),
+onlineDDL_(onlineDDL),
+pool_(StringPool::shared()),
+table_(),
+clauses_(),
+notes_(),
+droppedForeign_(),
+statement_(),
+summary_()
+{
+}
+
+void
+SQLEmitter::end()
+{
+	flushAlter();
+
+	if (onlineDDL_ && !summary_.empty())
+	{
+		printSummary();
+	}
+}
+
+std::unique_ptr<DiffEmitter>
+SQLEmitter::part(OutputSink& out) const
+{
+	return std::unique_ptr<DiffEmitter>(new SQLEmitter(out, skipColumnMoves_, singleAlter_, onlineDDL_));
+}
+
+void
+SQLEmitter::flush()
+{
+	flushAlter();
+}
+
+/* a table whose statements were counted just before the part's first ones
+   (the tables in between had none) keeps a single line in the summary
+*/
+
+void
+SQLEmitter::join(DiffEmitter& part, const std::string& text)
+{
+	const SQLEmitter& other = static_cast<const SQLEmitter&>(part);
+
+	flushAlter();
+	out_ << text;
+
+	std::vector<TableSummary>::const_iterator it = other.summary_.begin();
+	if (it != other.summary_.end() && !summary_.empty() && summary_.back().table == it->table)
+	{
+		for (int i = 0 ; i < 3 ; ++i)
+		{
+			summary_.back().statements[i] += it->statements[i];
+		}
+		summary_.back().rebuilds += it->rebuilds;
+		++it;
+	}
+
+	summary_.insert(summary_.end(), it, other.summary_.end());
+}
+
+void
+SQLEmitter::emit(const DiffOp& op)
+{
+	const SQLTable& ref = *op.table;
+	const TableNode& desc = op.node;
+
+	if (ref.name != table_ || op.kind == CREATE_TABLE || op.kind == DROP_TABLE || op.kind == RENAME_TABLE)
+	{
+		flushAlter();
+		table_ = ref.name;
+	}
+
+/* a skipped move only leaves its modify to be run
+*/
+
+	OnlineDDL ddl;
+	if (onlineDDL_)
+	{
+		DiffOp classified(op);
+		if (op.kind == MOVE_COLUMN && skipColumnMoves_)
+		{
+			classified.kind = MODIFY_COLUMN;
+		}
+		classified.moved = op.moved && !skipColumnMoves_;
+		ddl = classifyOperation(classified, singleAlter_, *pool_);
+	}
+
+	switch (op.kind)
+	{
+		case CREATE_TABLE:
+			createTable(ref);
+			return;
+
+		case DROP_TABLE:
+			out_ << "drop table " << ref.name << ";\n\n";
+			return;
+
+/* rename table takes no algorithm clause, it only changes the metadata
+*/
+
+		case RENAME_TABLE:
+			out_ << "rename table " << op.oldName << " to " << ref.name << ";\n\n";
+			if (onlineDDL_)
+			{
+				countStatement(ref.name, ddl);
+			}
+			return;
+
+		case ADD_COLUMN:
+			alterTable(ref, ddl, "add column " + desc.first + " " + desc.second.str() + " " + placement(ref, desc.first));
+			return;
+
+		case MODIFY_COLUMN:
+			alterTable(ref, ddl, "modify column " + desc.first + " " + desc.second.str());
+			return;
+
+		case MOVE_COLUMN:
+			if (skipColumnMoves_)
+			{
+				commentAlter(ref, "# column move skipped, it would rebuild the table:\n",
+					"modify column " + desc.first + " " + desc.second.str() + " " + placement(ref, desc.first), "");
+
+				if (op.modified)
+				{
+					alterTable(ref, ddl, "modify column " + desc.first + " " + desc.second.str());
+				}
+			}
+			else
+			{
+				alterTable(ref, ddl, "modify column " + desc.first + " " + desc.second.str() + " " + placement(ref, desc.first));
+			}
+			return;
+
+		case RENAME_COLUMN:
+			if (op.moved && skipColumnMoves_)
+			{
+				commentAlter(ref, "# column move skipped, it would rebuild the table:\n",
+					"change column " + op.oldName + " " + desc.first.str() + " " + desc.second.str() + " " + placement(ref, desc.first), "");
+				alterTable(ref, ddl, "change column " + op.oldName + " " + desc.first.str() + " " + desc.second.str());
+			}
+			else
+			{
+				alterTable(ref, ddl, "change column " + op.oldName + " " + desc.first.str() + " " + desc.second.str() +
+					(op.moved ? " " + placement(ref, desc.first) : std::string()));
+			}
+			return;
+
+		case DROP_COLUMN:
+			alterTable(ref, ddl, "drop column " + desc.first);
+			return;
+
+		case DROP_PRIMARY:
+			alterTable(ref, ddl, "drop primary key");
+			return;
+
+		case ADD_PRIMARY:
+			alterTable(ref, ddl, "add" + ((desc.second.size() > 0) ? " constraint " + desc.second : std::string()) +
+				" primary key " + desc.first.str());
+			return;
+
+		case DROP_FOREIGN:
+
+/* foreign key dropping can't be automatically implemented as it requires an
+   identifier created internally by the InnoDB engine
+*/
+
+			if (desc.second.size() > 0)
+			{
+				alterTable(ref, ddl, "drop foreign key " + desc.second);
+				droppedForeign_.push_back(desc.second);
+			}
+			else
+			{
+				commentAlter(ref, "# foreign key dropping can't be automatically implemented as it \n"
+					"# requires an identifier created internally by the InnoDB engine.\n",
+					"drop foreign key ??fk_symbol??", " // description: " + desc.first);
+			}
+			return;
+
+		case ADD_FOREIGN:
+
+/* mysql won't drop a foreign key and add one with the same name in the same
+   statement
+*/
+
+			if (std::find(droppedForeign_.begin(), droppedForeign_.end(), desc.second) != droppedForeign_.end())
+			{
+				flushAlter();
+				table_ = ref.name;
+			}
+
+			alterTable(ref, ddl, "add" + ((desc.second.size() > 0) ? " constraint " + desc.second : std::string()) +
+				" foreign key " + desc.first.str());
+			return;
+
+		case DROP_INDEX:
+			alterTable(ref, ddl, "drop index " + desc.second);
+			return;
+
+		case ADD_INDEX:
+			addKey(ref, ddl, "index", desc);
+			return;
+
+		case DROP_UNIQUE:
+		case DROP_FULLTEXT:
+		case DROP_SPATIAL:
+			alterTable(ref, ddl, "drop key " + desc.second);
+			return;
+
+		case ADD_UNIQUE:
+			addKey(ref, ddl, "unique", desc);
+			return;
+
+		case ADD_FULLTEXT:
+			addKey(ref, ddl, "fulltext", desc);
+			return;
+
+		case ADD_SPATIAL:
+			addKey(ref, ddl, "spatial", desc);
+			return;
+	}
+}
+
+/* one statement per clause, or the clause kept for the table's statement
+*/
+
+void
+SQLEmitter::alterTable(const SQLTable& ref, const OnlineDDL& ddl, const std::string& clause)
+{
+	if (singleAlter_)
+	{
+		clauses_.push_back(clause);
+		statement_.merge(ddl);
+	}
+	else
+	{
+		out_ << "alter table " << ref.name << " " << clause;
+		if (onlineDDL_)
+		{
+			out_ << ", " << ddlClause(ddl);
+			countStatement(ref.name, ddl);
+		}
+		out_ << ";\n\n";
+	}
+}
+
+/* a statement we only print as a comment, after the lines telling why; with a
+   single statement per table it goes above that statement
+*/
+
+void
+SQLEmitter::commentAlter(const SQLTable& ref, const char* why, const std::string& clause, const std::string& trailer)
+{
+	if (singleAlter_)
+	{
+		notes_ += why + ("# alter table " + ref.name) + " " + clause + ";" + trailer + "\n";
+	}
+	else
+	{
+		out_ << why << "# alter table " << ref.name << " " << clause << ";" << trailer << "\n\n";
+	}
+}
+
+void
+SQLEmitter::flushAlter()
+{
+	if (!notes_.empty())
+	{
+		out_ << notes_;
+		if (clauses_.empty())
+		{
+			out_ << "\n";
+		}
+	}
+
+	if (!clauses_.empty())
+	{
+		out_ << "alter table " << table_;
+		for (std::size_t i = 0 ; i < clauses_.size() ; ++i)
+		{
+			out_ << ((i == 0) ? "\n\t" : ",\n\t") << clauses_[i];
+		}
+		if (onlineDDL_)
+		{
+			out_ << ",\n\t" << ddlClause(statement_);
+			countStatement(table_, statement_);
+		}
+		out_ << ";\n\n";
+	}
+
+	statement_ = OnlineDDL();
+	clauses_.clear();
+	notes_.clear();
+	droppedForeign_.clear();
+}
+
+void
+SQLEmitter::countStatement(const Atom& table, const OnlineDDL& ddl)
+{
+	if (summary_.empty() || summary_.back().table != table)
+	{
+		summary_.push_back(TableSummary(table));
+	}
+
+	++summary_.back().statements[ddl.algorithm];
+	if (ddl.rebuild)
+	{
+		++summary_.back().rebuilds;
+	}
+}
+
+/* how the statements of each table will run, and how many times the script
+   rebuilds it
+*/
+
+void
+SQLEmitter::printSummary()
+{
+	std::size_t statements[3] = { 0, 0, 0 };
+	std::size_t rebuilds = 0, rebuiltTables = 0;
+
+	out_ << "# online ddl summary (statements by algorithm, table rebuilds):\n";
+
+	for (std::vector<TableSummary>::const_iterator it = summary_.begin() ; it != summary_.end() ; ++it)
+	{
+		out_ << "# " << it->table << ": "
+			<< std::to_string(it->statements[INSTANT_ALGORITHM]) << " instant, "
+			<< std::to_string(it->statements[INPLACE_ALGORITHM]) << " inplace, "
+			<< std::to_string(it->statements[COPY_ALGORITHM]) << " copy, "
+			<< std::to_string(it->rebuilds) << ((it->rebuilds == 1) ? " rebuild\n" : " rebuilds\n");
+
+		for (int i = 0 ; i < 3 ; ++i)
+		{
+			statements[i] += it->statements[i];
+		}
+		rebuilds += it->rebuilds;
+		rebuiltTables += (it->rebuilds > 0) ? 1 : 0;
+	}
+
+	out_ << "# total: " << std::to_string(statements[INSTANT_ALGORITHM]) << " instant, "
+		<< std::to_string(statements[INPLACE_ALGORITHM]) << " inplace, "
+		<< std::to_string(statements[COPY_ALGORITHM]) << " copy; "
+		<< std::to_string(rebuilds) << " rebuilds of " << std::to_string(rebuiltTables) << " of "
+		<< std::to_string(summary_.size()) << " altered tables\n\n";
+}
+
+void
+SQLEmitter::addKey(const SQLTable& ref, const OnlineDDL& ddl, const char* type, const TableNode& desc)
+{
+	alterTable(ref, ddl, "add " + (type + std::string(" ")) + ((desc.second.size() > 0) ? desc.second + " " : std::string()) +
+		"(" + desc.first.str() + ")");
+}
+
+void
+SQLEmitter::createTable(const SQLTable& ref)
+{
+	std::string body;
+
+	for(TableNodeList::const_iterator fit = ref.fields.begin(); fit != ref.fields.end(); ++fit)
+	{
+		body += "\n\t" + *fit + " " + ref.definition(*fit).str() + ",";
+	}
+
+	for(TableIndexList::const_iterator pit = ref.primary.begin(); pit != ref.primary.end(); ++pit)
+	{
+		body += "\n\t" + ((pit->second.size() > 0)?("constraint " + pit->second + " "):"") + "primary key " + pit->first.str() + ",";
+	}
+
+	for(TableIndexList::const_iterator oit = ref.foreign.begin(); oit != ref.foreign.end(); ++oit)
+	{
+		body += "\n\t" + ((oit->second.size() > 0)?("constraint " + oit->second + " "):"") + "foreign key " + oit->first.str() + ",";
+	}
+
+	const char* types[] = { "index ", "unique ", "fulltext ", "spatial " };
+	const TableIndexList* lists[] = { &ref.index, &ref.unique, &ref.fulltext, &ref.spatial };
+
+	for (int i = 0 ; i < 4 ; ++i)
+	{
+		for(TableIndexList::const_iterator kit = lists[i]->begin(); kit != lists[i]->end(); ++kit)
+		{
+			body += "\n\t" + (types[i] + ((kit->second.size() > 0)?kit->second + " ":"")) + "(" + kit->first.str() + "),";
+		}
+	}
+
+/* no comma after the last line
+*/
+
+	if (!body.empty())
+	{
+		body.erase(body.length() - 1);
+	}
+
+	out_ << "create table " << ref.name << "\n"
+		<< "(" << body << "\n) " << ref.tabletype << ";\n\n";
+}
+
+
+/* json */
+
+JSONEmitter::JSONEmitter(OutputSink& out, bool onlineDDL)
+:DiffEmitter(out),
+onlineDDL_(onlineDDL),
+pool_(StringPool::shared()),
+first_(true)
+{
+}
+
+void
+JSONEmitter::begin()
+{
+	out_ << "{\"operations\": [";
+	first_ = true;
+}
+
+void
+JSONEmitter::end()
+{
+	out_ << (first_ ? "]}\n" : "\n]}\n");
+}
+
+std::unique_ptr<DiffEmitter>
+JSONEmitter::part(OutputSink& out) const
+{
+	return std::unique_ptr<DiffEmitter>(new JSONEmitter(out, onlineDDL_));
+}
+
+/* a part starts its text as the first operation: the comma goes in here
+*/
+
+void
+JSONEmitter::join(DiffEmitter&, const std::string& text)
+{
+	if (!text.empty())
+	{
+		out_ << (first_ ? "" : ",") << text;
+		first_ = false;
+	}
+}
+
+void
+JSONEmitter::emit(const DiffOp& op)
+{
+	const SQLTable& ref = *op.table;
+	const TableNode& desc = op.node;
+
+	out_ << (first_ ? "\n\t{" : ",\n\t{");
+	first_ = false;
+
+	out_ << "\"op\": \"" << opName(op.kind) << "\"";
+	member("table", ref.name);
+
+	switch (op.kind)
+	{
+		case CREATE_TABLE:
+			out_ << ", \"columns\": [";
+			for (std::size_t i = 0 ; i < ref.fields.size() ; ++i)
+			{
+				out_ << ((i == 0) ? "{" : ", {");
+				out_ << "\"name\": ";
+				string(ref.fields[i]);
+				member("definition", ref.definition(ref.fields[i]));
+				out_ << "}";
+			}
+			out_ << "], \"keys\": [";
+			{
+				bool firstKey = true;
+				keys("primary", ref.primary, firstKey);
+				keys("foreign", ref.foreign, firstKey);
+				keys("index", ref.index, firstKey);
+				keys("unique", ref.unique, firstKey);
+				keys("fulltext", ref.fulltext, firstKey);
+				keys("spatial", ref.spatial, firstKey);
+			}
+			out_ << "]";
+			member("options", ref.tabletype);
+			break;
+
+		case DROP_TABLE:
+		case DROP_PRIMARY:
+			break;
+
+		case RENAME_TABLE:
+			member("from", op.oldName);
+			break;
+
+		case ADD_COLUMN:
+		case MOVE_COLUMN:
+			{
+				member("column", desc.first);
+				member("definition", desc.second);
+
+				const Atom* previous = predecessor(ref, desc.first);
+				out_ << ", \"after\": ";
+				if (previous == 0)
+				{
+					out_ << "null";
+				}
+				else
+				{
+					string(*previous);
+				}
+
+				if (op.kind == MOVE_COLUMN)
+				{
+					out_ << ", \"modified\": " << (op.modified ? "true" : "false");
+				}
+			}
+			break;
+
+		case MODIFY_COLUMN:
+			member("column", desc.first);
+			member("definition", desc.second);
+			break;
+
+		case RENAME_COLUMN:
+			member("column", desc.first);
+			member("from", op.oldName);
+			member("definition", desc.second);
+			out_ << ", \"moved\": " << (op.moved ? "true" : "false");
+			if (op.moved)
+			{
+				const Atom* previous = predecessor(ref, desc.first);
+				out_ << ", \"after\": ";
+				if (previous == 0)
+				{
+					out_ << "null";
+				}
+				else
+				{
+					string(*previous);
+				}
+			}
+			break;
+
+		case DROP_COLUMN:
+			member("column", desc.first);
+			break;
+
+		default:
+			member("columns", desc.first);
+			out_ << ", \"name\": ";
+			if (desc.second.empty())
+			{
+				out_ << "null";
+			}
+			else
+			{
+				string(desc.second);
+			}
+			break;
+	}
+
+	if (onlineDDL_ && op.kind != CREATE_TABLE && op.kind != DROP_TABLE && op.kind != RENAME_TABLE)
+	{
+		const OnlineDDL ddl(classifyOperation(op, false, *pool_));
+
+		out_ << ", \"algorithm\": \"" << ddl.algorithmName() << "\", \"lock\": ";
+		if (ddl.algorithm == INSTANT_ALGORITHM)
+		{
+			out_ << "null";
+		}
+		else
+		{
+			out_ << "\"" << ddl.lockName() << "\"";
+		}
+		out_ << ", \"rebuild\": " << (ddl.rebuild ? "true" : "false");
+	}
+
+	out_ << "}";
+}
+
+void
+JSONEmitter::member(const char* name, const std::string& value)
+{
+	out_ << ", \"" << name << "\": ";
+	string(value);
+}
+
+void
+JSONEmitter::keys(const char* type, const TableIndexList& list, bool& first)
+{
+	for (TableIndexList::const_iterator it = list.begin() ; it != list.end() ; ++it)
+	{
+		out_ << (first ? "{" : ", {");
+		first = false;
+
+		out_ << "\"type\": \"" << type << "\"";
+		member("columns", it->first);
+		out_ << ", \"name\": ";
+		if (it->second.empty())
+		{
+			out_ << "null";
+		}
+		else
+		{
+			string(it->second);
+		}
+		out_ << "}";
+	}
+}
+
+/* a quoted json string; the dump is taken byte by byte, anything that isn't
+   plain ascii is passed through as it is
+*/
+
+void
+JSONEmitter::string(const std::string& str)
+{
+	out_ << '"';
+
+	for (std::string::const_iterator it = str.begin() ; it != str.end() ; ++it)
+	{
+		switch (*it)
+		{
+			case '"': out_ << "\\\""; break;
+			case '\\': out_ << "\\\\"; break;
+			case '\n': out_ << "\\n"; break;
+			case '\r': out_ << "\\r"; break;
+			case '\t': out_ << "\\t"; break;
+
+			default:
+				if (static_cast<unsigned char>(*it) < 0x20)
+				{
+					char escaped[8];
+					std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(*it));
+					out_ << escaped;
+				}
+				else
+				{
+					out_ << *it;
+				}
+		}
+	}
+
+	out_ << '"';
+}
+
+} //namespace
@@ -0,0 +1,181 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef DIFFEMITTER_HPP
+#define DIFFEMITTER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DiffOp.hpp"
+#include "OnlineDDL.hpp"
+#include "OutputSink.hpp"
+
+namespace sqlfileparser
+{
+
+/* turns the operations into text as they come, straight into the sink; begin()
+   and end() wrap the whole script
+*/
+
+class DiffEmitter
+{
+	public:
+
+		DiffEmitter(OutputSink& out);
+
+		virtual ~DiffEmitter();
+
+		virtual void begin();
+
+		virtual void emit(const DiffOp& op) = 0;
+
+		virtual void end();
+
+/* formatting on several threads: part() gives an emitter like this one that
+   writes into "out", or 0 if this one can't be split (the default). A part is
+   given the operations of one table, then flush() writes whatever it still
+   holds back; join() puts the text of the part after ours and takes over what
+   the part counted. The parts are joined in the order of their operations.
+*/
+
+		virtual std::unique_ptr<DiffEmitter> part(OutputSink& out) const;
+
+		virtual void flush();
+
+		virtual void join(DiffEmitter& part, const std::string& text);
+
+	protected:
+
+		OutputSink& out_;
+};
+
+/* the mysql upgrade script; columns that only changed their position are moved
+   with "modify column ... after ..." and every move rebuilds the table: with
+   skipColumnMoves they are only printed as comments.
+   Every operation is a statement of its own, or with singleAlter all those of
+   a table are clauses of one "alter table", in the same order, so the table
+   is rebuilt once.
+   With onlineDDL every statement says the algorithm and lock it can run with
+   (see classifyOperation()), and the script ends with the count of them and
+   of the table rebuilds, table by table.
+*/
+
+class SQLEmitter : public DiffEmitter
+{
+	public:
+
+		SQLEmitter(OutputSink& out, bool skipColumnMoves = false, bool singleAlter = false, bool onlineDDL = false);
+
+		virtual void emit(const DiffOp& op);
+
+		virtual void end();
+
+		virtual std::unique_ptr<DiffEmitter> part(OutputSink& out) const;
+
+		virtual void flush();
+
+		virtual void join(DiffEmitter& part, const std::string& text);
+
+	private:
+
+		void createTable(const SQLTable& ref);
+
+		void alterTable(const SQLTable& ref, const OnlineDDL& ddl, const std::string& clause);
+
+		void commentAlter(const SQLTable& ref, const char* why, const std::string& clause, const std::string& trailer);
+
+		void flushAlter();
+
+		void countStatement(const Atom& table, const OnlineDDL& ddl);
+
+		void printSummary();
+
+		void addKey(const SQLTable& ref, const OnlineDDL& ddl, const char* type, const TableNode& desc);
+
+		struct TableSummary {
+
+			TableSummary(const Atom& t)
+			:table(t),
+			rebuilds(0)
+			{
+				statements[0] = statements[1] = statements[2] = 0;
+			}
+
+			Atom table;
+
+			std::size_t statements[3];
+
+			std::size_t rebuilds;
+		};
+
+		const bool skipColumnMoves_;
+
+		const bool singleAlter_;
+
+		const bool onlineDDL_;
+
+		std::shared_ptr<StringPool> pool_;
+
+/* the table whose statement is being put together, its clauses and the
+   commented out ones
+*/
+
+		Atom table_;
+
+		std::vector<std::string> clauses_;
+
+		std::string notes_;
+
+		std::vector<Atom> droppedForeign_;
+
+/* the algorithm of the statement being put together, and the statements
+   written so far, table by table
+*/
+
+		OnlineDDL statement_;
+
+		std::vector<TableSummary> summary_;
+};
+
+/* the same operations for other tools: {"operations": [ {...}, ... ]}, one
+   object per statement with its "op" name and the table, column and key it
+   is about; with onlineDDL, the algorithm and lock each can run with
+*/
+
+class JSONEmitter : public DiffEmitter
+{
+	public:
+
+		JSONEmitter(OutputSink& out, bool onlineDDL = false);
+
+		virtual void begin();
+
+		virtual void emit(const DiffOp& op);
+
+		virtual void end();
+
+		virtual std::unique_ptr<DiffEmitter> part(OutputSink& out) const;
+
+		virtual void join(DiffEmitter& part, const std::string& text);
+
+	private:
+
+		void string(const std::string& str);
+
+		void member(const char* name, const std::string& value);
+
+		void keys(const char* type, const TableIndexList& list, bool& first);
+
+		const bool onlineDDL_;
+
+		std::shared_ptr<StringPool> pool_;
+
+		bool first_;
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,88 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef DIFFOP_HPP
+#define DIFFOP_HPP
+
+#include <vector>
+
+#include "SQLParserHelper.hpp"
+
+namespace sqlfileparser
+{
+
+enum DiffOpKind {
+	CREATE_TABLE = 0,
+	DROP_TABLE,
+	RENAME_TABLE,
+	ADD_COLUMN,
+	MODIFY_COLUMN,
+	MOVE_COLUMN,
+	RENAME_COLUMN,
+	DROP_COLUMN,
+	DROP_PRIMARY,
+	ADD_PRIMARY,
+	DROP_FOREIGN,
+	ADD_FOREIGN,
+	DROP_INDEX,
+	ADD_INDEX,
+	DROP_UNIQUE,
+	ADD_UNIQUE,
+	DROP_FULLTEXT,
+	ADD_FULLTEXT,
+	DROP_SPATIAL,
+	ADD_SPATIAL
+};
+
+/* one statement of the upgrade script, without its text: the emitters decide
+   how it is written.
+   "table" is the table of the version the statement is about (the old one for
+   drops, the new one otherwise); "node" is the column (name, definition) or
+   the key (description, name) as stored in the table, empty for table
+   statements and for DROP_PRIMARY. "modified" tells, for MOVE_COLUMN, that the
+   definition changed as well.
+   A RENAME_COLUMN has the new column in "node", the name it had in "oldName",
+   and "moved" tells that it changes its position as well.
+   A RENAME_TABLE has the name the table had in "oldName"; the statements
+   following it are about the new table, its drops included.
+   "before" and "after" are both versions of the table, for the statements of
+   a table found in both (null otherwise).
+*/
+
+struct DiffOp {
+
+	DiffOp(DiffOpKind k, const SQLTable& t, const TableNode& n = TableNode(), bool m = false)
+	:kind(k),
+	table(&t),
+	node(n),
+	modified(m),
+	oldName(),
+	moved(false),
+	before(0),
+	after(0)
+	{
+	}
+
+	DiffOpKind kind;
+
+	const SQLTable* table;
+
+	TableNode node;
+
+	bool modified;
+
+	Atom oldName;
+
+	bool moved;
+
+	const SQLTable* before;
+
+	const SQLTable* after;
+};
+
+typedef std::vector<DiffOp> DiffOpList;
+
+} // namespace
+
+#endif
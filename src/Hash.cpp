@@ -0,0 +1,213 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "Hash.hpp"
+
+namespace sqlfileparser
+{
+
+static const std::uint64_t C1 = 0x87c37b91114253d5ULL;
+static const std::uint64_t C2 = 0x4cf5ad432745937fULL;
+
+static inline std::uint64_t
+rotl(std::uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline std::uint64_t
+fmix(std::uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+
+	return k;
+}
+
+/* little endian loads whatever the host, so the hashes can be stored on disk
+*/
+
+static inline std::uint64_t
+load64(const unsigned char* p)
+{
+	std::uint64_t v = 0;
+	for (int i = 7 ; i >= 0 ; --i)
+	{
+		v = (v << 8) | p[i];
+	}
+
+	return v;
+}
+
+std::string
+Hash128::hex() const
+{
+	char buf[33];
+	std::snprintf(buf, sizeof(buf), "%016llx%016llx", (unsigned long long)hi, (unsigned long long)lo);
+
+	return std::string(buf, 32);
+}
+
+Hasher128::Hasher128(std::uint64_t seed)
+:h1_(seed),
+h2_(seed),
+tailSize_(0),
+length_(0)
+{
+}
+
+void
+Hasher128::block(const unsigned char* data)
+{
+	std::uint64_t k1 = load64(data);
+	std::uint64_t k2 = load64(data + 8);
+
+	k1 *= C1; k1 = rotl(k1, 31); k1 *= C2; h1_ ^= k1;
+	h1_ = rotl(h1_, 27); h1_ += h2_; h1_ = h1_ * 5 + 0x52dce729;
+
+	k2 *= C2; k2 = rotl(k2, 33); k2 *= C1; h2_ ^= k2;
+	h2_ = rotl(h2_, 31); h2_ += h1_; h2_ = h2_ * 5 + 0x38495ab5;
+}
+
+void
+Hasher128::update(const void* data, std::size_t len)
+{
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	length_ += len;
+
+	if (tailSize_ > 0)
+	{
+		std::size_t n = 16 - tailSize_;
+		if (n > len)
+		{
+			n = len;
+		}
+
+		std::memcpy(tail_ + tailSize_, p, n);
+		tailSize_ += n;
+		p += n;
+		len -= n;
+
+		if (tailSize_ < 16)
+		{
+			return;
+		}
+
+		block(tail_);
+		tailSize_ = 0;
+	}
+
+	for ( ; len >= 16 ; p += 16, len -= 16)
+	{
+		block(p);
+	}
+
+	std::memcpy(tail_, p, len);
+	tailSize_ = len;
+}
+
+void
+Hasher128::field(std::string_view str)
+{
+	update(str);
+
+	const unsigned char separator = 0;
+	update(&separator, 1);
+}
+
+void
+Hasher128::number(std::uint64_t value)
+{
+	unsigned char buf[8];
+	for (int i = 0 ; i < 8 ; ++i, value >>= 8)
+	{
+		buf[i] = value & 0xff;
+	}
+
+	update(buf, sizeof(buf));
+}
+
+Hash128
+Hasher128::digest() const
+{
+	std::uint64_t h1 = h1_;
+	std::uint64_t h2 = h2_;
+	std::uint64_t k1 = 0;
+	std::uint64_t k2 = 0;
+
+	for (std::size_t i = tailSize_ ; i > 8 ; --i)
+	{
+		k2 = (k2 << 8) | tail_[i - 1];
+	}
+
+	for (std::size_t i = (tailSize_ > 8) ? 8 : tailSize_ ; i > 0 ; --i)
+	{
+		k1 = (k1 << 8) | tail_[i - 1];
+	}
+
+	if (tailSize_ > 8)
+	{
+		k2 *= C2; k2 = rotl(k2, 33); k2 *= C1; h2 ^= k2;
+	}
+
+	if (tailSize_ > 0)
+	{
+		k1 *= C1; k1 = rotl(k1, 31); k1 *= C2; h1 ^= k1;
+	}
+
+	h1 ^= length_;
+	h2 ^= length_;
+
+	h1 += h2;
+	h2 += h1;
+
+	h1 = fmix(h1);
+	h2 = fmix(h2);
+
+	h1 += h2;
+	h2 += h1;
+
+	Hash128 result;
+	result.lo = h1;
+	result.hi = h2;
+
+	return result;
+}
+
+Hash128
+hashFile(const std::string& fname)
+{
+	std::ifstream input(fname.c_str(), std::ios::binary);
+	if (!input.is_open())
+	{
+		throw std::runtime_error("cannot open file " + fname + " for reading.");
+	}
+
+	Hasher128 hasher;
+	std::vector<char> buffer(1 << 20);
+
+	while (input.good())
+	{
+		input.read(&buffer[0], buffer.size());
+		hasher.update(&buffer[0], input.gcount());
+	}
+
+	if (input.bad())
+	{
+		throw std::runtime_error("error while reading file " + fname + ".");
+	}
+
+	return hasher.digest();
+}
+
+} //namespace
@@ -0,0 +1,77 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace sqlfileparser
+{
+
+struct Hash128 {
+
+	std::uint64_t lo, hi;
+
+	bool operator==(const Hash128& other) const { return lo == other.lo && hi == other.hi; }
+
+	bool operator!=(const Hash128& other) const { return !(*this == other); }
+
+	bool operator<(const Hash128& other) const { return hi < other.hi || (hi == other.hi && lo < other.lo); }
+
+/* 32 hex digits, for file names
+*/
+
+	std::string hex() const;
+};
+
+/* MurmurHash3 (x64, 128 bit), fed incrementally; the result only depends on
+   the bytes, not on how they were split between the update() calls.
+   Not a cryptographic hash: good enough to tell schemas apart, not to resist
+   somebody crafting collisions on purpose.
+*/
+
+class Hasher128
+{
+	public:
+
+		Hasher128(std::uint64_t seed = 0);
+
+		void update(const void* data, std::size_t len);
+
+		void update(std::string_view str) { update(str.data(), str.size()); }
+
+/* strings followed by a separator, so ("ab", "c") and ("a", "bc") differ
+*/
+
+		void field(std::string_view str);
+
+		void number(std::uint64_t value);
+
+		Hash128 digest() const;
+
+	private:
+
+		void block(const unsigned char* data);
+
+		std::uint64_t h1_, h2_;
+
+		unsigned char tail_[16];
+
+		std::size_t tailSize_;
+
+		std::uint64_t length_;
+};
+
+/* the hash of a whole file, read in large blocks
+*/
+
+	Hash128 hashFile(const std::string& fname);
+
+} // namespace
+
+#endif
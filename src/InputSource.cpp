@@ -0,0 +1,142 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "InputSource.hpp"
+
+namespace sqlfileparser
+{
+
+/* the size of the blocks read from a stream
+*/
+
+static const std::size_t STREAM_BLOCK_SIZE = 1 << 20;
+
+StreamInputSource::StreamInputSource(std::istream& input)
+:input_(input),
+block_(STREAM_BLOCK_SIZE)
+{
+}
+
+bool
+StreamInputSource::next(const char*& begin, const char*& end)
+{
+	if (!input_.good())
+	{
+		return false;
+	}
+
+	input_.read(&block_[0], block_.size());
+
+	std::streamsize n = input_.gcount();
+	if (n <= 0)
+	{
+		return false;
+	}
+
+	begin = &block_[0];
+	end = begin + n;
+
+	return true;
+}
+
+MemoryInputSource::MemoryInputSource(const char* begin, const char* end)
+:begin_(begin),
+end_(end),
+consumed_(false)
+{
+}
+
+bool
+MemoryInputSource::next(const char*& begin, const char*& end)
+{
+	if (consumed_ || begin_ == end_)
+	{
+		return false;
+	}
+
+	consumed_ = true;
+	begin = begin_;
+	end = end_;
+
+	return true;
+}
+
+MappedInputSource::MappedInputSource(const std::string& fname)
+:data_(0),
+size_(0),
+consumed_(false)
+{
+	int fd = ::open(fname.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw std::runtime_error("cannot open file " + fname + " for reading.");
+	}
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		throw std::runtime_error("cannot stat file " + fname + ".");
+	}
+
+	size_ = st.st_size;
+
+/* mmap() refuses empty mappings; an empty file is simply an empty input
+*/
+
+	if (size_ > 0)
+	{
+		void* addr = ::mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED)
+		{
+			::close(fd);
+			throw std::runtime_error("cannot map file " + fname + " into memory.");
+		}
+
+		::madvise(addr, size_, MADV_SEQUENTIAL);
+		data_ = static_cast<const char*>(addr);
+	}
+
+	::close(fd);
+}
+
+MappedInputSource::~MappedInputSource()
+{
+	if (data_ != 0)
+	{
+		::munmap(const_cast<char*>(data_), size_);
+	}
+}
+
+bool
+MappedInputSource::next(const char*& begin, const char*& end)
+{
+	if (consumed_ || size_ == 0)
+	{
+		return false;
+	}
+
+	consumed_ = true;
+	begin = data_;
+	end = data_ + size_;
+
+	return true;
+}
+
+bool
+MappedInputSource::canMap(const std::string& fname)
+{
+	struct stat st;
+
+	return ::stat(fname.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+} //namespace
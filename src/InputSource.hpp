@@ -0,0 +1,105 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef INPUTSOURCE_HPP
+#define INPUTSOURCE_HPP
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace sqlfileparser
+{
+
+/* the lexer pulls its input from one of these, a block at a time; a block stays
+   valid until the next call
+*/
+
+class InputSource
+{
+	public:
+
+		virtual ~InputSource() {}
+
+		virtual bool next(const char*& begin, const char*& end) = 0;
+};
+
+/* any std::istream (stdin, pipes...), read in large blocks
+*/
+
+class StreamInputSource : public InputSource
+{
+	public:
+
+		StreamInputSource(std::istream& input);
+
+		bool next(const char*& begin, const char*& end);
+
+	private:
+
+		std::istream& input_;
+
+		std::vector<char> block_;
+};
+
+/* a range of memory owned by somebody else, as one single block
+*/
+
+class MemoryInputSource : public InputSource
+{
+	public:
+
+		MemoryInputSource(const char* begin, const char* end);
+
+		bool next(const char*& begin, const char*& end);
+
+	private:
+
+		const char* begin_;
+
+		const char* end_;
+
+		bool consumed_;
+};
+
+/* a regular file mapped into memory and handed out as one single block, so
+   nothing gets copied before the lexer looks at it
+*/
+
+class MappedInputSource : public InputSource
+{
+	public:
+
+		MappedInputSource(const std::string& fname);
+
+		~MappedInputSource();
+
+		bool next(const char*& begin, const char*& end);
+
+		const char* data() const { return data_; }
+
+		std::size_t size() const { return size_; }
+
+/* false for pipes, devices... which have to go through StreamInputSource
+*/
+
+		static bool canMap(const std::string& fname);
+
+	private:
+
+		MappedInputSource(const MappedInputSource&);
+
+		MappedInputSource& operator=(const MappedInputSource&);
+
+		const char* data_;
+
+		std::size_t size_;
+
+		bool consumed_;
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,395 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <strings.h>
+#include <vector>
+
+#include "LazyLexParse.hpp"
+#include "CompressedInputSource.hpp"
+#include "Hash.hpp"
+#include "InputSource.hpp"
+#include "Parallel.hpp"
+#include "SQLLexer.hpp"
+#include "SkipScan.hpp"
+
+namespace sqlfileparser
+{
+
+namespace
+{
+
+/* where a "create table" statement sits in the file: from "create" to the ";"
+   included
+*/
+
+struct TableExtent {
+	std::string name;
+	const char* begin;
+	const char* end;
+	unsigned long line;
+	Hash128 hash;
+};
+
+/* thrown when the first pass isn't sure about something; the caller falls back
+   to a full parse, which reports the real problem if there is one
+*/
+
+class IndexError : public std::runtime_error
+{
+	public:
+
+		IndexError(const std::string& what) : std::runtime_error(what) {}
+};
+
+inline bool
+isBlank(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+inline bool
+isAlpha(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+inline bool
+isAlphaExt(char c)
+{
+	return isAlpha(c) || (c >= '0' && c <= '9') || c == '_';
+}
+
+/* case insensitive "word" at p, the same way the lexer folds its (?i:) rules
+*/
+
+bool
+matchWord(const char* p, const char* end, const char* word)
+{
+	std::size_t len = std::strlen(word);
+
+	return static_cast<std::size_t>(end - p) >= len && ::strncasecmp(p, word, len) == 0;
+}
+
+/* the TABLENAME context of the lexer: "if not exists" is skipped, every
+   identifier replaces the name seen so far ("db.table" ends up as "table"),
+   everything else is ignored up to the opening parenthesis
+*/
+
+const char*
+readTableName(const char* p, const char* end, std::string& name)
+{
+	while (p != end && *p != '(')
+	{
+		if (*p == ')')
+		{
+			throw IndexError("unexpected ) in table name");
+		}
+
+		if (matchWord(p, end, "if") && p + 2 != end && isBlank(p[2]))
+		{
+			const char* q = p + 2;
+			while (q != end && isBlank(*q)) ++q;
+
+			if (matchWord(q, end, "not") && q + 3 != end && isBlank(q[3]))
+			{
+				q += 3;
+				while (q != end && isBlank(*q)) ++q;
+
+				if (matchWord(q, end, "exists"))
+				{
+					p = q + 6;
+					continue;
+				}
+			}
+		}
+
+		if (*p == '`' && p + 1 != end && isAlpha(p[1]))
+		{
+			const char* q = p + 1;
+			while (q != end && isAlphaExt(*q)) ++q;
+
+			if (q != end && *q == '`')
+			{
+				name.assign(p + 1, q);
+				p = q + 1;
+				continue;
+			}
+		}
+
+		if (isAlpha(*p))
+		{
+			const char* q = p;
+			while (q != end && isAlphaExt(*q)) ++q;
+
+			name.assign(p, q);
+			p = q;
+			continue;
+		}
+
+		++p;
+	}
+
+	if (p == end || name.empty())
+	{
+		throw IndexError("no table definition");
+	}
+
+	return p;
+}
+
+/* from the opening parenthesis of the definition to the matching closing one;
+   parentheses between quotes don't count
+*/
+
+const char*
+skipDefinition(const char* p, const char* end)
+{
+	int depth = 0;
+	char quote = 0;
+
+	for ( ; p != end ; ++p)
+	{
+		if (quote != 0)
+		{
+			if (*p == '\\' && p + 1 != end)
+			{
+				++p;
+			}
+			else if (*p == quote)
+			{
+				quote = 0;
+			}
+		}
+		else if (*p == '\'' || *p == '"' || *p == '`')
+		{
+			quote = *p;
+		}
+		else if (*p == '(')
+		{
+			++depth;
+		}
+		else if (*p == ')' && --depth == 0)
+		{
+			return p;
+		}
+	}
+
+	throw IndexError("unbalanced parentheses");
+}
+
+/* the table options are hashed as well, except for AUTO_INCREMENT=n which only
+   tells how many rows the table had when it was dumped
+*/
+
+void
+hashOptions(Hasher128& hasher, const char* p, const char* end)
+{
+	static const char autoIncrement[] = "auto_increment=";
+	const std::size_t len = sizeof(autoIncrement) - 1;
+
+	const char* from = p;
+	while (p != end)
+	{
+		if ((*p | 0x20) == 'a' && matchWord(p, end, autoIncrement))
+		{
+			hasher.update(from, p - from);
+
+			p += len;
+			while (p != end && *p >= '0' && *p <= '9') ++p;
+			from = p;
+		}
+		else
+		{
+			++p;
+		}
+	}
+
+	hasher.update(from, p - from);
+}
+
+std::vector<TableExtent>
+indexTables(const char* begin, const char* end)
+{
+	std::vector<TableExtent> extents;
+	unsigned long line = 1;
+
+	for (const char* p = begin ; p != end ; )
+	{
+		bool partial;
+		const char* found = findCreateTable(p, end, line, partial);
+		if (found == end || partial)
+		{
+			break;
+		}
+
+		TableExtent extent;
+		extent.begin = found;
+		extent.line = line;
+
+		const char* q = found + 6;
+		while (isBlank(*q)) ++q;
+
+		q = readTableName(q + 5, end, extent.name);
+		q = skipDefinition(q, end);
+
+		const char* semicolon = static_cast<const char*>(std::memchr(q, ';', end - q));
+		if (semicolon == 0)
+		{
+			throw IndexError("missing ;");
+		}
+
+/* the lexer refuses a new "create table" before the ";"
+*/
+
+		unsigned long ignored = 0;
+		if (findCreateTable(q, semicolon, ignored, partial) != semicolon)
+		{
+			throw IndexError("missing ;");
+		}
+
+		extent.end = semicolon + 1;
+
+		Hasher128 hasher;
+		hasher.update(found, q - found);
+		hashOptions(hasher, q, extent.end);
+		extent.hash = hasher.digest();
+
+		line += std::count(found, extent.end, '\n');
+		p = extent.end;
+
+		extents.push_back(extent);
+	}
+
+	return extents;
+}
+
+typedef std::map<std::string, const TableExtent*> ExtentIndex;
+
+ExtentIndex
+byName(const std::vector<TableExtent>& extents)
+{
+	ExtentIndex index;
+
+	for (std::vector<TableExtent>::const_iterator it = extents.begin() ; it != extents.end() ; ++it)
+	{
+		if (!index.insert(std::make_pair(it->name, &*it)).second)
+		{
+			throw IndexError("duplicate table " + it->name);
+		}
+	}
+
+	return index;
+}
+
+/* the tables of one version that have no identical twin in the other one, in
+   file order
+*/
+
+std::vector<const TableExtent*>
+changedTables(const std::vector<TableExtent>& extents, const ExtentIndex& other)
+{
+	std::vector<const TableExtent*> changed;
+
+	for (std::vector<TableExtent>::const_iterator it = extents.begin() ; it != extents.end() ; ++it)
+	{
+		ExtentIndex::const_iterator twin = other.find(it->name);
+		if (twin == other.end() || twin->second->hash != it->hash)
+		{
+			changed.push_back(&*it);
+		}
+	}
+
+	return changed;
+}
+
+} // anonymous namespace
+
+bool
+lexParseChanged(const std::string& fname1, const std::string& fname2, bool skipModifiedTimestamps,
+	unsigned int threads, std::ostream& log, SQLTableListManagerPtr& psm1, SQLTableListManagerPtr& psm2)
+{
+	const std::string* fnames[2] = { &fname1, &fname2 };
+
+	for (int i = 0 ; i < 2 ; ++i)
+	{
+		if (!MappedInputSource::canMap(*fnames[i]) || CompressedInputSource::isCompressed(*fnames[i]))
+		{
+			return false;
+		}
+	}
+
+	MappedInputSource file1(fname1), file2(fname2);
+	const MappedInputSource* files[2] = { &file1, &file2 };
+
+	std::vector<TableExtent> extents[2];
+	std::vector<const TableExtent*> changed[2];
+
+	try
+	{
+		parallelFor(2, 2, [&] (std::size_t i) {
+			extents[i] = indexTables(files[i]->data(), files[i]->data() + files[i]->size());
+		});
+
+		ExtentIndex index1(byName(extents[0])), index2(byName(extents[1]));
+
+		changed[0] = changedTables(extents[0], index2);
+		changed[1] = changedTables(extents[1], index1);
+	}
+	catch(IndexError&)
+	{
+		return false;
+	}
+
+/* the second pass: one lexer per table, the tables of both versions sharing
+   the threads
+*/
+
+	std::vector<const TableExtent*> work(changed[0]);
+	work.insert(work.end(), changed[1].begin(), changed[1].end());
+
+	std::vector<SQLTableListManagerPtr> results(work.size());
+	std::vector<std::string> warnings(work.size());
+
+	try
+	{
+		parallelFor(work.size(), threads, [&] (std::size_t i) {
+			const char* base = (i < changed[0].size()) ? file1.data() : file2.data();
+
+			MemoryInputSource source(work[i]->begin, work[i]->end);
+			std::ostringstream tableLog;
+			SQLLexer lex(source, skipModifiedTimestamps, work[i]->line, work[i]->begin - base, tableLog);
+
+			results[i] = lex.parse();
+
+			if (!lex.complete() || results[i]->rawtlist().size() != 1 || results[i]->rawtlist().front().name.str() != work[i]->name)
+			{
+				throw IndexError("the lexer disagrees with the index");
+			}
+
+			warnings[i] = tableLog.str();
+		});
+	}
+	catch(std::exception&)
+	{
+		return false;
+	}
+
+	psm1.reset(new SQLTableListManager);
+	psm2.reset(new SQLTableListManager);
+
+	for (std::size_t i = 0 ; i < results.size() ; ++i)
+	{
+		((i < changed[0].size()) ? psm1 : psm2)->append(*results[i]);
+		log << warnings[i];
+	}
+
+	return true;
+}
+
+} //namespace
@@ -0,0 +1,35 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef LAZYLEXPARSE_HPP
+#define LAZYLEXPARSE_HPP
+
+#include <ostream>
+#include <string>
+
+#include "SQLParserHelper.hpp"
+
+namespace sqlfileparser
+{
+
+/* parses two versions of a dump in two passes: the first one only finds every
+   "create table" statement and hashes all of its text but the
+   "auto_increment=N" table option (the counter changes all the time and no
+   statement is ever generated for it), the second one runs the lexer on the
+   tables whose hash differs between the versions or which only exist in one of
+   them. Tables hashing the same may still differ in that counter, but in
+   nothing the diff looks at, so they can't add any statement to the upgrade
+   script; they are not in psm1 / psm2 and their warnings aren't printed.
+   Only regular, uncompressed files qualify; when one of them doesn't, or when
+   the first pass finds something it isn't sure the lexer would read the same way
+   (duplicate table names, unbalanced parentheses, a missing ";"...), false is
+   returned and the caller has to parse both files in full.
+*/
+
+	bool lexParseChanged(const std::string& fname1, const std::string& fname2, bool skipModifiedTimestamps,
+		unsigned int threads, std::ostream& log, SQLTableListManagerPtr& psm1, SQLTableListManagerPtr& psm2);
+
+} // namespace
+
+#endif
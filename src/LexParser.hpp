@@ -5,17 +5,35 @@
 #ifndef LEXPARSER_HPP
 #define LEXPARSER_HPP
 
-#include <istream>
+#include <iostream>
+#include <string>
 
 #include "SQLParserHelper.hpp"
 
 namespace sqlfileparser
 {
 
-/* returning a smart pointer reference
+/* every call owns its own scanner state and table list, so several inputs
+   can be parsed at the same time from different threads; warnings go to "log"
 */
 
-	SQLTableListManagerPtr& lexParse(std::istream& input, bool skipModifiedTimestamps = false);
+	SQLTableListManagerPtr lexParse(std::istream& input, bool skipModifiedTimestamps = false, std::ostream& log = std::cerr);
+
+/* .gz, .zst and .xz files are decompressed on a separate thread; other regular
+   files are mapped into memory and scanned in place, on "threads" threads;
+   anything else (pipes, devices, "-" for stdin) goes through the stream
+   version above.
+   "fname" may also be a directory with one *-schema.sql file per table (the
+   mydumper layout); the files are then parsed on "threads" threads.
+*/
+
+	SQLTableListManagerPtr lexParse(const std::string& fname, bool skipModifiedTimestamps = false, unsigned int threads = 1, std::ostream& log = std::cerr);
+
+/* the same inputs read on one thread, every table going to "handler" as soon
+   as its statement is over; nothing is kept once the handler returns
+*/
+
+	void lexParseStreaming(const std::string& fname, bool skipModifiedTimestamps, const SQLTableHandler& handler, std::ostream& log = std::cerr);
 
 } // namespace
 
@@ -0,0 +1,315 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+#include "MigrationPlan.hpp"
+
+namespace sqlfileparser
+{
+
+namespace
+{
+
+std::string
+humanBytes(std::uint64_t bytes)
+{
+	static const char* units[] = { "B", "KB", "MB", "GB", "TB", "PB" };
+
+	double value = static_cast<double>(bytes);
+	std::size_t unit = 0;
+
+	while (value >= 1024 && unit + 1 < sizeof(units) / sizeof(units[0]))
+	{
+		value /= 1024;
+		++unit;
+	}
+
+	char text[32];
+	std::snprintf(text, sizeof(text), (unit == 0) ? "%.0f %s" : "%.1f %s", value, units[unit]);
+
+	return text;
+}
+
+std::string
+humanDuration(double seconds)
+{
+	if (seconds < 1)
+	{
+		return (seconds > 0) ? "<1s" : "0s";
+	}
+
+	const std::uint64_t total = static_cast<std::uint64_t>(seconds + 0.5);
+	char text[48];
+
+	if (total >= 3600)
+	{
+		std::snprintf(text, sizeof(text), "%lluh %02llum %02llus", static_cast<unsigned long long>(total / 3600),
+			static_cast<unsigned long long>(total / 60 % 60), static_cast<unsigned long long>(total % 60));
+	}
+	else if (total >= 60)
+	{
+		std::snprintf(text, sizeof(text), "%llum %02llus", static_cast<unsigned long long>(total / 60),
+			static_cast<unsigned long long>(total % 60));
+	}
+	else
+	{
+		std::snprintf(text, sizeof(text), "%llus", static_cast<unsigned long long>(total));
+	}
+
+	return text;
+}
+
+bool
+buildsIndex(DiffOpKind kind)
+{
+	return kind == ADD_INDEX || kind == ADD_UNIQUE || kind == ADD_FULLTEXT || kind == ADD_SPATIAL || kind == ADD_FOREIGN;
+}
+
+} // anonymous namespace
+
+PlanEmitter::PlanEmitter(OutputSink& out, const TableSizeMap& sizes, double throughput, bool skipColumnMoves, bool singleAlter)
+:DiffEmitter(out),
+sizes_(sizes),
+throughput_(throughput),
+skipColumnMoves_(skipColumnMoves),
+singleAlter_(singleAlter),
+pool_(StringPool::shared()),
+tables_(),
+pending_(),
+pendingStatement_(false),
+pendingIndex_(false),
+droppedForeign_()
+{
+}
+
+void
+PlanEmitter::emit(const DiffOp& op)
+{
+	if (tables_.empty() || tables_.back().table != op.table->name || op.kind == CREATE_TABLE || op.kind == DROP_TABLE)
+	{
+		flushStatement();
+		tables_.push_back(TablePlan(op.table->name));
+	}
+
+	DiffOp classified(op);
+
+	switch (op.kind)
+	{
+		case CREATE_TABLE:
+			tables_.back().kind = "create";
+			++tables_.back().statements;
+			return;
+
+		case DROP_TABLE:
+			tables_.back().kind = "drop";
+			++tables_.back().statements;
+			return;
+
+/* a statement of its own, whatever singleAlter says; the table keeps its data
+   and its rows are known under the old name
+*/
+
+		case RENAME_TABLE:
+			tables_.back().oldName = op.oldName;
+			count(classifyOperation(op, false, *pool_), false);
+			return;
+
+/* the same statements SQLEmitter writes: skipped moves and foreign keys we
+   don't know the name of are only comments there
+*/
+
+		case MOVE_COLUMN:
+			if (skipColumnMoves_)
+			{
+				if (!op.modified)
+				{
+					return;
+				}
+				classified.kind = MODIFY_COLUMN;
+			}
+			break;
+
+		case RENAME_COLUMN:
+			classified.moved = op.moved && !skipColumnMoves_;
+			break;
+
+		case DROP_FOREIGN:
+			if (op.node.second.empty())
+			{
+				return;
+			}
+			droppedForeign_.push_back(op.node.second);
+			break;
+
+		case ADD_FOREIGN:
+			if (std::find(droppedForeign_.begin(), droppedForeign_.end(), op.node.second) != droppedForeign_.end())
+			{
+				flushStatement();
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	statement(classifyOperation(classified, singleAlter_, *pool_), buildsIndex(op.kind));
+}
+
+void
+PlanEmitter::statement(const OnlineDDL& ddl, bool buildsIndex)
+{
+	if (singleAlter_)
+	{
+		pending_.merge(ddl);
+		pendingStatement_ = true;
+		pendingIndex_ = pendingIndex_ || buildsIndex;
+	}
+	else
+	{
+		count(ddl, buildsIndex);
+	}
+}
+
+void
+PlanEmitter::flushStatement()
+{
+	if (pendingStatement_)
+	{
+		count(pending_, pendingIndex_);
+	}
+
+	pending_ = OnlineDDL();
+	pendingStatement_ = pendingIndex_ = false;
+	droppedForeign_.clear();
+}
+
+void
+PlanEmitter::count(const OnlineDDL& ddl, bool buildsIndex)
+{
+	TablePlan& plan = tables_.back();
+
+	++plan.statements;
+	plan.ddl.merge(ddl);
+
+	if (ddl.rebuild)
+	{
+		++plan.rebuilds;
+	}
+	else if (buildsIndex)
+	{
+		++plan.indexBuilds;
+	}
+}
+
+std::string
+PlanEmitter::tableName(const TablePlan& plan) const
+{
+	return plan.oldName.empty() ? plan.table.str() : plan.oldName + " -> " + plan.table.str();
+}
+
+const char*
+PlanEmitter::className(const TablePlan& plan) const
+{
+	if (plan.kind != 0)
+	{
+		return plan.kind;
+	}
+
+	if (plan.ddl.algorithm == COPY_ALGORITHM)
+	{
+		return "copy";
+	}
+
+	if (plan.ddl.rebuild)
+	{
+		return "rebuild";
+	}
+
+	return (plan.ddl.algorithm == INPLACE_ALGORITHM) ? "in-place" : "instant";
+}
+
+void
+PlanEmitter::end()
+{
+	flushStatement();
+
+	std::uint64_t totalBytes = 0;
+	std::size_t totalRebuilds = 0, unknown = 0, nameWidth = 5;
+
+	for (std::vector<TablePlan>::iterator it = tables_.begin() ; it != tables_.end() ; ++it)
+	{
+		TableSizeMap::const_iterator size = sizes_.find(it->oldName.empty() ? it->table : it->oldName);
+		if (size == sizes_.end() && !it->oldName.empty())
+		{
+			size = sizes_.find(it->table);
+		}
+
+		if (size != sizes_.end())
+		{
+			it->size = &size->second;
+			it->bytes = it->rebuilds * (size->second.dataLength + size->second.indexLength) +
+				it->indexBuilds * size->second.dataLength;
+		}
+		else if (it->rebuilds + it->indexBuilds > 0)
+		{
+			++unknown;
+		}
+
+		totalBytes += it->bytes;
+		totalRebuilds += it->rebuilds;
+		nameWidth = std::max(nameWidth, tableName(*it).size());
+	}
+
+/* the dearest first, those whose cost we can't tell last
+*/
+
+	std::stable_sort(tables_.begin(), tables_.end(), [] (const TablePlan& a, const TablePlan& b) {
+		const bool knownA = a.size != 0 || a.rebuilds + a.indexBuilds == 0;
+		const bool knownB = b.size != 0 || b.rebuilds + b.indexBuilds == 0;
+
+		if (knownA != knownB)
+		{
+			return knownA;
+		}
+
+		return a.bytes > b.bytes;
+	});
+
+	const double bytesPerSecond = throughput_ * 1048576.0;
+	std::ostringstream report;
+
+	report << "# migration plan: " << tables_.size() << " tables, " << totalRebuilds << " rebuilds, "
+		<< humanBytes(totalBytes) << " rewritten, about " << humanDuration(totalBytes / bytesPerSecond)
+		<< " at " << throughput_ << " MB/s";
+	if (unknown > 0)
+	{
+		report << ", " << unknown << " of them of unknown size";
+	}
+	report << "\n\n";
+
+	report << std::left << std::setw(nameWidth + 2) << "table" << std::setw(10) << "class" << std::setw(8) << "lock"
+		<< std::right << std::setw(10) << "statements" << std::setw(10) << "rebuilds" << std::setw(14) << "rows"
+		<< std::setw(12) << "rewritten" << std::setw(14) << "time" << "\n";
+
+	for (std::vector<TablePlan>::const_iterator it = tables_.begin() ; it != tables_.end() ; ++it)
+	{
+		const bool known = it->size != 0 || it->rebuilds + it->indexBuilds == 0;
+		const bool locking = it->kind == 0 && it->ddl.algorithm != INSTANT_ALGORITHM;
+
+		report << std::left << std::setw(nameWidth + 2) << tableName(*it) << std::setw(10) << className(*it)
+			<< std::setw(8) << (locking ? it->ddl.lockName() : "-")
+			<< std::right << std::setw(10) << it->statements << std::setw(10) << it->rebuilds
+			<< std::setw(14) << ((it->size != 0) ? std::to_string(it->size->rows) : std::string("?"))
+			<< std::setw(12) << (known ? humanBytes(it->bytes) : std::string("?"))
+			<< std::setw(14) << (known ? humanDuration(it->bytes / bytesPerSecond) : std::string("?")) << "\n";
+	}
+
+	out_ << report.str();
+}
+
+} //namespace
@@ -0,0 +1,112 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef MIGRATIONPLAN_HPP
+#define MIGRATIONPLAN_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DiffEmitter.hpp"
+#include "OnlineDDL.hpp"
+#include "TableStats.hpp"
+
+namespace sqlfileparser
+{
+
+/* what the upgrade script would cost, table by table, instead of the script:
+   how each table is changed (instant, in place, rebuilt in place or copied),
+   how many bytes that rewrites according to "sizes" and how long it takes at
+   "throughput" MB/s, the dearest tables first.
+   The statements are counted the way SQLEmitter writes them with the same
+   skipColumnMoves and singleAlter. A rebuild rewrites the data and the
+   indexes, a new index reads the data; the rest only touches the metadata.
+*/
+
+class PlanEmitter : public DiffEmitter
+{
+	public:
+
+		PlanEmitter(OutputSink& out, const TableSizeMap& sizes, double throughput,
+			bool skipColumnMoves = false, bool singleAlter = false);
+
+		virtual void emit(const DiffOp& op);
+
+		virtual void end();
+
+	private:
+
+		struct TablePlan {
+
+			TablePlan(const Atom& t)
+			:table(t),
+			oldName(),
+			kind(0),
+			ddl(),
+			statements(0),
+			rebuilds(0),
+			indexBuilds(0),
+			size(0),
+			bytes(0)
+			{
+			}
+
+			Atom table;
+
+/* the name it had, for a renamed table
+*/
+
+			Atom oldName;
+
+/* "create", "drop", or 0 for a table that is altered
+*/
+
+			const char* kind;
+
+			OnlineDDL ddl;
+
+			std::size_t statements, rebuilds, indexBuilds;
+
+			const TableSize* size;
+
+			std::uint64_t bytes;
+		};
+
+		void statement(const OnlineDDL& ddl, bool buildsIndex);
+
+		void count(const OnlineDDL& ddl, bool buildsIndex);
+
+		void flushStatement();
+
+		std::string tableName(const TablePlan& plan) const;
+
+		const char* className(const TablePlan& plan) const;
+
+		const TableSizeMap& sizes_;
+
+		const double throughput_;
+
+		const bool skipColumnMoves_;
+
+		const bool singleAlter_;
+
+		std::shared_ptr<StringPool> pool_;
+
+		std::vector<TablePlan> tables_;
+
+/* with singleAlter, the statement of the last table, as it grows
+*/
+
+		OnlineDDL pending_;
+
+		bool pendingStatement_, pendingIndex_;
+
+		std::vector<Atom> droppedForeign_;
+};
+
+} // namespace
+
+#endif
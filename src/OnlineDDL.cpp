@@ -0,0 +1,340 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <string>
+
+#include "OnlineDDL.hpp"
+#include "ColumnDescriptor.hpp"
+
+namespace sqlfileparser
+{
+
+namespace
+{
+
+const OnlineDDL COPY_DDL(COPY_ALGORITHM, SHARED_LOCK, true);
+
+/* how many bytes a character may take; the tables that don't say are in the
+   server's charset, utf8mb4 since 8.0
+*/
+
+std::size_t
+maxCharBytes(const Atom& charset)
+{
+	const std::string& name = charset.str();
+
+	if (name == "latin1" || name == "latin2" || name == "latin5" || name == "latin7" || name == "ascii" ||
+		name == "binary" || name == "cp1250" || name == "cp1251" || name == "cp1256" || name == "cp1257" ||
+		name == "cp850" || name == "cp852" || name == "cp866" || name == "greek" || name == "hebrew" ||
+		name == "koi8r" || name == "koi8u" || name == "swe7" || name == "tis620" || name == "armscii8")
+	{
+		return 1;
+	}
+
+	if (name == "ucs2" || name == "big5" || name == "gbk" || name == "sjis" || name == "cp932" ||
+		name == "euckr" || name == "gb2312")
+	{
+		return 2;
+	}
+
+	if (name == "utf8" || name == "ujis" || name == "eucjpms")
+	{
+		return 3;
+	}
+
+	return 4;
+}
+
+/* a varchar keeps its length in one byte up to 255 bytes, in two above: a
+   longer column with the same length prefix is only a change of metadata
+*/
+
+bool
+extendsInPlace(const ColumnDescriptor& d1, const ColumnDescriptor& d2)
+{
+	if ((d1.type != VARCHAR_TYPE && d1.type != VARBINARY_TYPE) || d1.length < 0 || d2.length < d1.length)
+	{
+		return false;
+	}
+
+	const std::size_t charBytes = (d1.type == VARCHAR_TYPE) ? maxCharBytes(d1.charset) : 1;
+
+	return (d1.length * charBytes <= 255) == (d2.length * charBytes <= 255);
+}
+
+/* the values of a canonical enum / set list ('a','b''c',...)
+*/
+
+std::size_t
+countValues(const std::string& values)
+{
+	if (values.empty())
+	{
+		return 0;
+	}
+
+	std::size_t count = 1;
+	bool quoted = false;
+
+	for (std::size_t i = 0 ; i < values.size() ; ++i)
+	{
+		if (quoted && values[i] == '\\')
+		{
+			++i;
+		}
+		else if (values[i] == '\'')
+		{
+			quoted = !quoted;
+		}
+		else if (!quoted && values[i] == ',')
+		{
+			++count;
+		}
+	}
+
+	return count;
+}
+
+std::size_t
+valueBytes(ColumnType type, std::size_t count)
+{
+	if (type == ENUM_TYPE)
+	{
+		return (count <= 255) ? 1 : 2;
+	}
+
+	const std::size_t bytes = (count + 7) / 8;
+
+	return (bytes > 4) ? 8 : bytes;
+}
+
+/* new enum / set values at the end of the list, taking no more room
+*/
+
+bool
+appendsValues(const ColumnDescriptor& d1, const ColumnDescriptor& d2)
+{
+	const std::string& values1 = d1.values.str();
+	const std::string& values2 = d2.values.str();
+
+	if (values2.compare(0, values1.size(), values1) != 0 || (values2.size() > values1.size() && values2[values1.size()] != ','))
+	{
+		return false;
+	}
+
+	return valueBytes(d1.type, countValues(values1)) == valueBytes(d2.type, countValues(values2));
+}
+
+bool
+hasWord(const Atom& words, const char* word)
+{
+	return (" " + words.str() + " ").find(" " + std::string(word) + " ") != std::string::npos;
+}
+
+/* the column goes after the last one the table had, and the table has nothing
+   that forbids adding it instantly
+*/
+
+bool
+appendsColumn(const DiffOp& op)
+{
+	const SQLTable& before = *op.before;
+	const SQLTable& after = *op.after;
+
+	if (before.fields.empty() || !before.fulltext.empty() ||
+		before.tabletype.str().find("row_format=compressed") != std::string::npos)
+	{
+		return false;
+	}
+
+	std::size_t last = after.fields.size();
+	while (last > 0 && before.position(after.fields[last - 1]) == SQLTable::NOPOSITION)
+	{
+		--last;
+	}
+
+	return last > 0 && after.fields[last - 1] == before.fields.back() && last <= after.position(op.node.first);
+}
+
+OnlineDDL
+classifyAdd(const DiffOp& op, StringPool& pool)
+{
+	const ColumnDescriptor column(describeColumn(op.node.second, describeTableCharset(op.after->tabletype, pool), pool));
+
+	if (hasWord(column.rest, "stored"))
+	{
+		return COPY_DDL;
+	}
+
+	if (column.autoIncrement)
+	{
+		return OnlineDDL(INPLACE_ALGORITHM, SHARED_LOCK, true);
+	}
+
+	if (appendsColumn(op))
+	{
+		return OnlineDDL(INSTANT_ALGORITHM);
+	}
+
+	return OnlineDDL(INPLACE_ALGORITHM, NONE_LOCK, true);
+}
+
+/* a new default or new enum values at the end are instant, a longer varchar
+   or a new comment in place, a change of nullability a rebuild, anything
+   touching the type, the charset or what is stored is a copy
+*/
+
+OnlineDDL
+classifyModify(const DiffOp& op, StringPool& pool)
+{
+	const Atom& name = op.node.first;
+	if (op.before->position(name) == SQLTable::NOPOSITION)
+	{
+		return COPY_DDL;
+	}
+
+	const ColumnDescriptor d1(describeColumn(op.before->definition(name), describeTableCharset(op.before->tabletype, pool), pool));
+	const ColumnDescriptor d2(describeColumn(op.node.second, describeTableCharset(op.after->tabletype, pool), pool));
+
+	if (d1.type != d2.type || d1.typeName != d2.typeName || d1.isUnsigned != d2.isUnsigned || d1.zerofill != d2.zerofill ||
+		d1.charset != d2.charset || d1.collation != d2.collation || d1.autoIncrement != d2.autoIncrement ||
+		d1.onUpdate != d2.onUpdate || d1.rest != d2.rest || d1.scale != d2.scale)
+	{
+		return COPY_DDL;
+	}
+
+	OnlineDDL result;
+
+	if (d1.length != d2.length)
+	{
+		if (!extendsInPlace(d1, d2))
+		{
+			return COPY_DDL;
+		}
+		result.merge(OnlineDDL(INPLACE_ALGORITHM));
+	}
+
+	if (d1.values != d2.values && !appendsValues(d1, d2))
+	{
+		return COPY_DDL;
+	}
+
+	if (d1.nullable != d2.nullable)
+	{
+		result.merge(OnlineDDL(INPLACE_ALGORITHM, NONE_LOCK, true));
+	}
+
+	if (d1.comment != d2.comment)
+	{
+		result.merge(OnlineDDL(INPLACE_ALGORITHM));
+	}
+
+	return result;
+}
+
+} // anonymous namespace
+
+void
+OnlineDDL::merge(const OnlineDDL& other)
+{
+	algorithm = (other.algorithm > algorithm) ? other.algorithm : algorithm;
+	lock = (other.lock > lock) ? other.lock : lock;
+	rebuild = rebuild || other.rebuild;
+}
+
+const char*
+OnlineDDL::algorithmName() const
+{
+	static const char* names[] = { "instant", "inplace", "copy" };
+
+	return names[algorithm];
+}
+
+const char*
+OnlineDDL::lockName() const
+{
+	static const char* names[] = { "none", "shared", "exclusive" };
+
+	return names[lock];
+}
+
+OnlineDDL
+classifyOperation(const DiffOp& op, bool together, StringPool& pool)
+{
+	if (op.before == 0 || op.after == 0)
+	{
+		return OnlineDDL();
+	}
+
+	switch (op.kind)
+	{
+		case ADD_COLUMN:
+			return classifyAdd(op, pool);
+
+		case MODIFY_COLUMN:
+			return classifyModify(op, pool);
+
+		case MOVE_COLUMN:
+			{
+				OnlineDDL result(INPLACE_ALGORITHM, NONE_LOCK, true);
+				if (op.modified)
+				{
+					result.merge(classifyModify(op, pool));
+				}
+				return result;
+			}
+
+/* renaming is in place (instant from 8.0.28 on), moving it a rebuild
+*/
+
+		case RENAME_COLUMN:
+			return OnlineDDL(INPLACE_ALGORITHM, NONE_LOCK, op.moved);
+
+		case DROP_COLUMN:
+		case ADD_PRIMARY:
+			return OnlineDDL(INPLACE_ALGORITHM, NONE_LOCK, true);
+
+/* without a primary key in between InnoDB has to copy the rows
+*/
+
+		case DROP_PRIMARY:
+			if (together && !op.after->primary.empty())
+			{
+				return OnlineDDL(INPLACE_ALGORITHM, NONE_LOCK, true);
+			}
+			return COPY_DDL;
+
+/* in place only with foreign_key_checks off, which we can't tell
+*/
+
+		case ADD_FOREIGN:
+			return COPY_DDL;
+
+		case ADD_FULLTEXT:
+			return OnlineDDL(INPLACE_ALGORITHM, SHARED_LOCK, op.before->fulltext.empty());
+
+		case ADD_SPATIAL:
+			return OnlineDDL(INPLACE_ALGORITHM, SHARED_LOCK);
+
+		case ADD_INDEX:
+		case ADD_UNIQUE:
+		case DROP_FOREIGN:
+		case DROP_INDEX:
+		case DROP_UNIQUE:
+		case DROP_FULLTEXT:
+		case DROP_SPATIAL:
+			return OnlineDDL(INPLACE_ALGORITHM);
+
+/* only the data dictionary changes
+*/
+
+		case RENAME_TABLE:
+			return OnlineDDL();
+
+		default:
+			return OnlineDDL();
+	}
+}
+
+} //namespace
@@ -0,0 +1,70 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef ONLINEDDL_HPP
+#define ONLINEDDL_HPP
+
+#include "DiffOp.hpp"
+#include "StringPool.hpp"
+
+namespace sqlfileparser
+{
+
+/* from the cheapest to the dearest, so the dearest of two is the greatest
+*/
+
+enum DDLAlgorithm {
+	INSTANT_ALGORITHM = 0,
+	INPLACE_ALGORITHM,
+	COPY_ALGORITHM
+};
+
+enum DDLLock {
+	NONE_LOCK = 0,
+	SHARED_LOCK,
+	EXCLUSIVE_LOCK
+};
+
+/* how MySQL 8 can run a statement without blocking the table: the cheapest
+   algorithm it accepts, the weakest lock that goes with it, and whether the
+   table gets rebuilt (copy always does)
+*/
+
+struct OnlineDDL {
+
+	OnlineDDL(DDLAlgorithm a = INSTANT_ALGORITHM, DDLLock l = NONE_LOCK, bool r = false)
+	:algorithm(a),
+	lock(l),
+	rebuild(r)
+	{
+	}
+
+/* what a statement doing both needs
+*/
+
+	void merge(const OnlineDDL& other);
+
+	const char* algorithmName() const;
+
+	const char* lockName() const;
+
+	DDLAlgorithm algorithm;
+
+	DDLLock lock;
+
+	bool rebuild;
+};
+
+/* the operations of a table in the order they are run; "together" when they
+   are all clauses of the same statement (a primary key dropped and added back
+   at once is a rebuild, the drop alone a copy).
+   The rules are those every 8.0 release knows: a column is only added
+   instantly at the end of the table, and dropped in place.
+*/
+
+	OnlineDDL classifyOperation(const DiffOp& op, bool together, StringPool& pool);
+
+} // namespace
+
+#endif
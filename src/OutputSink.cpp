@@ -0,0 +1,81 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <cstring>
+#include <stdexcept>
+
+#include "OutputSink.hpp"
+
+namespace sqlfileparser
+{
+
+OutputSink::OutputSink(std::ostream& out, std::size_t blockSize)
+:out_(out),
+copy_(0),
+block_(blockSize),
+used_(0),
+written_(0)
+{
+}
+
+OutputSink::~OutputSink()
+{
+	if (used_ > 0)
+	{
+		output(&block_[0], used_);
+	}
+}
+
+void
+OutputSink::write(const char* data, std::size_t len)
+{
+	written_ += len;
+
+	if (used_ + len > block_.size())
+	{
+		flush();
+
+/* bigger than a whole block: no point in copying it
+*/
+
+		if (len > block_.size())
+		{
+			output(data, len);
+			return;
+		}
+	}
+
+	std::memcpy(&block_[used_], data, len);
+	used_ += len;
+}
+
+void
+OutputSink::flush()
+{
+	if (used_ > 0)
+	{
+		output(&block_[0], used_);
+		used_ = 0;
+	}
+
+	out_.flush();
+
+	if (!out_.good())
+	{
+		throw std::runtime_error("error while writing the output.");
+	}
+}
+
+void
+OutputSink::output(const char* data, std::size_t len)
+{
+	out_.write(data, len);
+
+	if (copy_ != 0 && !copy_->write(data, len).good())
+	{
+		copy_ = 0;
+	}
+}
+
+} //namespace
@@ -0,0 +1,82 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef OUTPUTSINK_HPP
+#define OUTPUTSINK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "StringPool.hpp"
+
+namespace sqlfileparser
+{
+
+/* collects the output in one large block and hands it to the stream only when
+   the block is full, instead of going through the stream for every token
+*/
+
+class OutputSink
+{
+	public:
+
+		OutputSink(std::ostream& out, std::size_t blockSize = 1 << 20);
+
+/* flush() has to be called explicitly to see the errors; the destructor
+   writes what is left but can't report anything
+*/
+
+		~OutputSink();
+
+		void write(const char* data, std::size_t len);
+
+		OutputSink& operator<<(std::string_view str) { write(str.data(), str.size()); return *this; }
+
+		OutputSink& operator<<(const std::string& str) { write(str.data(), str.size()); return *this; }
+
+		OutputSink& operator<<(const char* str) { return *this << std::string_view(str); }
+
+		OutputSink& operator<<(const Atom& atom) { return *this << atom.str(); }
+
+		OutputSink& operator<<(char c) { write(&c, 1); return *this; }
+
+		void flush();
+
+/* every block also goes to "copy" (the result cache) as it is written; a copy
+   that fails is simply left out from then on, the output goes on
+*/
+
+		void tee(std::ostream& copy) { copy_ = &copy; }
+
+/* all the bytes given to write() so far
+*/
+
+		std::uint64_t written() const { return written_; }
+
+	private:
+
+		OutputSink(const OutputSink&);
+
+		OutputSink& operator=(const OutputSink&);
+
+		void output(const char* data, std::size_t len);
+
+		std::ostream& out_;
+
+		std::ostream* copy_;
+
+		std::vector<char> block_;
+
+		std::size_t used_;
+
+		std::uint64_t written_;
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,80 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include "Parallel.hpp"
+
+namespace sqlfileparser
+{
+
+void
+parallelFor(std::size_t count, unsigned int threads, const std::function<void(std::size_t)>& task)
+{
+	if (threads <= 1 || count <= 1)
+	{
+		for (std::size_t i = 0 ; i < count ; ++i)
+		{
+			task(i);
+		}
+		return;
+	}
+
+	std::atomic<std::size_t> nextIndex(0);
+	std::vector<std::exception_ptr> errors(count);
+
+	auto worker = [&] {
+		for (;;)
+		{
+			std::size_t i = nextIndex++;
+			if (i >= count)
+			{
+				return;
+			}
+
+			try
+			{
+				task(i);
+			}
+			catch(...)
+			{
+				errors[i] = std::current_exception();
+			}
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (std::size_t t = 1 ; t < threads && t < count ; ++t)
+	{
+		pool.push_back(std::thread(worker));
+	}
+
+	worker();
+
+	for (std::vector<std::thread>::iterator it = pool.begin() ; it != pool.end() ; ++it)
+	{
+		it->join();
+	}
+
+	for (std::vector<std::exception_ptr>::const_iterator it = errors.begin() ; it != errors.end() ; ++it)
+	{
+		if (*it)
+		{
+			std::rethrow_exception(*it);
+		}
+	}
+}
+
+unsigned int
+defaultThreadCount()
+{
+	unsigned int n = std::thread::hardware_concurrency();
+
+	return (n > 0) ? n : 1;
+}
+
+} //namespace
@@ -0,0 +1,29 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <cstddef>
+#include <functional>
+
+namespace sqlfileparser
+{
+
+/* runs task(0) ... task(count - 1) on up to "threads" threads (the caller's
+   included); the threads take the next index as soon as they are done with the
+   previous one. If some tasks throw, the exception of the lowest index is
+   rethrown once all of them have finished.
+*/
+
+	void parallelFor(std::size_t count, unsigned int threads, const std::function<void(std::size_t)>& task);
+
+/* the value of "--threads 0"
+*/
+
+	unsigned int defaultThreadCount();
+
+} // namespace
+
+#endif
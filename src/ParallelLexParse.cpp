@@ -0,0 +1,219 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "ParallelLexParse.hpp"
+#include "LexParser.hpp"
+#include "SQLLexer.hpp"
+#include "SkipScan.hpp"
+#include "Parallel.hpp"
+
+namespace sqlfileparser
+{
+
+/* pieces smaller than this aren't worth a thread; every thread gets a few
+   pieces so a huge table doesn't leave the others idle
+*/
+
+static const std::size_t MIN_CHUNK_SIZE = 4 << 20;
+
+static const std::size_t CHUNKS_PER_THREAD = 4;
+
+namespace
+{
+
+struct Chunk {
+	const char* begin;
+	const char* end;
+	unsigned long firstLine;
+};
+
+std::vector<Chunk>
+splitChunks(const char* begin, const char* end, unsigned int threads)
+{
+	std::size_t target = std::max<std::size_t>(MIN_CHUNK_SIZE, (end - begin) / (threads * CHUNKS_PER_THREAD));
+
+	std::vector<Chunk> chunks;
+	Chunk current = { begin, end, 1 };
+	unsigned long line = 1;
+
+	for (const char* p = begin ; p != end ; )
+	{
+		bool partial;
+		const char* found = findCreateTable(p, end, line, partial);
+		if (found == end || partial)
+		{
+			break;
+		}
+
+		if (found - current.begin >= static_cast<std::ptrdiff_t>(target) && (found[-1] == '\n' || found[-1] == '\r'))
+		{
+			current.end = found;
+			chunks.push_back(current);
+
+			current.begin = found;
+			current.firstLine = line;
+		}
+
+		p = found + 1;
+	}
+
+	current.end = end;
+	chunks.push_back(current);
+
+	return chunks;
+}
+
+SQLTableListManagerPtr
+lexParseSerial(const char* begin, const char* end, bool skipModifiedTimestamps, std::ostream& log)
+{
+	MemoryInputSource source(begin, end);
+	SQLLexer lex(source, skipModifiedTimestamps, 1, 0, log);
+
+	return lex.parse();
+}
+
+/* mydumper writes db.table-schema.sql for tables, next to db-schema-create.sql,
+   db.view-schema-view.sql, db.table-schema-triggers.sql... which we don't want
+*/
+
+bool
+isSchemaFile(const std::string& name)
+{
+	static const char* const suffixes[] = { "-schema.sql", "-schema.sql.gz", "-schema.sql.zst", "-schema.sql.xz" };
+
+	for (std::size_t i = 0 ; i < sizeof(suffixes) / sizeof(suffixes[0]) ; ++i)
+	{
+		const std::string suffix(suffixes[i]);
+		if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+} // anonymous namespace
+
+SQLTableListManagerPtr
+lexParseParallel(const char* begin, const char* end, bool skipModifiedTimestamps, unsigned int threads, std::ostream& log)
+{
+	std::vector<Chunk> chunks(splitChunks(begin, end, threads));
+
+	if (chunks.size() < 2)
+	{
+		return lexParseSerial(begin, end, skipModifiedTimestamps, log);
+	}
+
+	std::vector<SQLTableListManagerPtr> results(chunks.size());
+	std::vector<std::string> warnings(chunks.size());
+
+	try
+	{
+		parallelFor(chunks.size(), threads, [&] (std::size_t i) {
+			MemoryInputSource source(chunks[i].begin, chunks[i].end);
+			std::ostringstream chunkLog;
+			SQLLexer lex(source, skipModifiedTimestamps, chunks[i].firstLine, chunks[i].begin - begin, chunkLog);
+
+			results[i] = lex.parse();
+
+			if (i + 1 < chunks.size() && !lex.complete())
+			{
+				throw std::runtime_error("table cut in two");
+			}
+
+			warnings[i] = chunkLog.str();
+		});
+	}
+	catch(std::exception&)
+	{
+		return lexParseSerial(begin, end, skipModifiedTimestamps, log);
+	}
+
+	for (std::size_t i = 1 ; i < results.size() ; ++i)
+	{
+		results[0]->append(*results[i]);
+	}
+
+	for (std::vector<std::string>::const_iterator it = warnings.begin() ; it != warnings.end() ; ++it)
+	{
+		log << *it;
+	}
+
+	return results[0];
+}
+
+bool
+isDumpDirectory(const std::string& dname)
+{
+	std::error_code ec;
+
+	return std::filesystem::is_directory(dname, ec);
+}
+
+std::vector<std::string>
+dumpDirectoryFiles(const std::string& dname)
+{
+	std::vector<std::string> files;
+	std::error_code ec;
+
+	for (std::filesystem::directory_iterator it(dname, ec), end_it ; !ec && it != end_it ; it.increment(ec))
+	{
+		const std::string name(it->path().filename().string());
+		if (isSchemaFile(name) && it->is_regular_file(ec))
+		{
+			files.push_back(it->path().string());
+		}
+	}
+
+	if (ec)
+	{
+		throw std::runtime_error("cannot read directory " + dname + ": " + ec.message());
+	}
+
+	if (files.empty())
+	{
+		throw std::runtime_error("no *-schema.sql files in directory " + dname + ".");
+	}
+
+	std::sort(files.begin(), files.end());
+
+	return files;
+}
+
+SQLTableListManagerPtr
+lexParseDirectory(const std::string& dname, bool skipModifiedTimestamps, unsigned int threads, std::ostream& log)
+{
+	const std::vector<std::string> files(dumpDirectoryFiles(dname));
+
+	std::vector<SQLTableListManagerPtr> results(files.size());
+	std::vector<std::string> warnings(files.size());
+
+	parallelFor(files.size(), threads, [&] (std::size_t i) {
+		std::ostringstream fileLog;
+		results[i] = lexParse(files[i], skipModifiedTimestamps, 1, fileLog);
+		warnings[i] = fileLog.str();
+	});
+
+	for (std::size_t i = 1 ; i < results.size() ; ++i)
+	{
+		results[0]->append(*results[i]);
+	}
+
+	for (std::vector<std::string>::const_iterator it = warnings.begin() ; it != warnings.end() ; ++it)
+	{
+		log << *it;
+	}
+
+	return results[0];
+}
+
+} //namespace
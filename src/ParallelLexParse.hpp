@@ -0,0 +1,47 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef PARALLELLEXPARSE_HPP
+#define PARALLELLEXPARSE_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "SQLParserHelper.hpp"
+
+namespace sqlfileparser
+{
+
+/* parses a dump held in memory on several threads: the dump is cut right before
+   "create table" statements that start a line, every piece gets its own lexer
+   and table list, and the lists are joined back in file order.
+   If a piece can't be parsed on its own (a cut that landed inside a table, or a
+   genuine syntax error) the whole dump is parsed again on one thread, so the
+   result and the error messages are always those of the serial parser.
+*/
+
+	SQLTableListManagerPtr lexParseParallel(const char* begin, const char* end, bool skipModifiedTimestamps, unsigned int threads, std::ostream& log);
+
+/* true for a directory holding a dump in the mydumper layout
+*/
+
+	bool isDumpDirectory(const std::string& dname);
+
+/* the *-schema.sql files (compressed or not) of such a directory, sorted by
+   name
+*/
+
+	std::vector<std::string> dumpDirectoryFiles(const std::string& dname);
+
+/* parses every *-schema.sql file (compressed or not) of such a directory on
+   "threads" threads; the tables are joined in file name order, so the result
+   doesn't depend on the directory listing or on the thread count
+*/
+
+	SQLTableListManagerPtr lexParseDirectory(const std::string& dname, bool skipModifiedTimestamps, unsigned int threads, std::ostream& log);
+
+} // namespace
+
+#endif
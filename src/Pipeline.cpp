@@ -0,0 +1,374 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "Pipeline.hpp"
+#include "CompressedInputSource.hpp"
+#include "InputSource.hpp"
+#include "SQLLexer.hpp"
+
+namespace sqlfileparser
+{
+
+/* the size of the blocks read from the file and how many of them, and of the
+   tables on their way, may be in flight between two stages
+*/
+
+static const std::size_t PIPELINE_BLOCK_SIZE = 1 << 20;
+
+static const std::size_t PIPELINE_BLOCK_COUNT = 8;
+
+static const std::size_t PIPELINE_TABLE_COUNT = 256;
+
+namespace
+{
+
+typedef std::vector<char> Block;
+
+/* what the differ hands to the writer: the operations point into the table
+*/
+
+struct TableOps {
+	std::unique_ptr<SQLTable> table;
+	DiffOpList ops;
+};
+
+/* unwinds a stage whose queue was cancelled; the error that caused it is the
+   one reported
+*/
+
+class Cancelled
+{
+};
+
+/* the same choice of input as lexParse(), without the parallel parsing
+*/
+
+std::unique_ptr<InputSource>
+openSource(const std::string& fname, std::ifstream& file)
+{
+	if (fname == "-")
+	{
+		return std::unique_ptr<InputSource>(new StreamInputSource(std::cin));
+	}
+
+	if (CompressedInputSource::isCompressed(fname))
+	{
+		return std::unique_ptr<InputSource>(new CompressedInputSource(fname));
+	}
+
+	if (MappedInputSource::canMap(fname))
+	{
+		return std::unique_ptr<InputSource>(new MappedInputSource(fname));
+	}
+
+	file.open(fname.c_str());
+	if (!file.good())
+	{
+		throw std::runtime_error("cannot open file " + fname + " for reading.");
+	}
+
+	return std::unique_ptr<InputSource>(new StreamInputSource(file));
+}
+
+/* the scanner's end of the reader queue; a block goes back to the reader
+   once the lexer asks for the next one
+*/
+
+class QueueInputSource : public InputSource
+{
+	public:
+
+		QueueInputSource(SPSCQueue<Block>& blocks, SPSCQueue<Block>& recycled, StageStats& stats)
+		:blocks_(blocks),
+		recycled_(recycled),
+		stats_(stats),
+		current_()
+		{
+		}
+
+		bool next(const char*& begin, const char*& end)
+		{
+			if (!current_.empty())
+			{
+				recycled_.tryPush(current_);
+				current_.clear();
+			}
+
+			if (!blocks_.pop(current_, stats_))
+			{
+				return false;
+			}
+
+			stats_.bytes += current_.size();
+
+			begin = current_.data();
+			end = begin + current_.size();
+
+			return true;
+		}
+
+	private:
+
+		SPSCQueue<Block>& blocks_;
+
+		SPSCQueue<Block>& recycled_;
+
+		StageStats& stats_;
+
+		Block current_;
+};
+
+/* the file (decompressed, mapped, whatever it takes) copied into blocks: for
+   a mapped file this is where the pages are actually read from the disk
+*/
+
+void
+readStage(const std::string& fname, SPSCQueue<Block>& blocks, SPSCQueue<Block>& recycled, StageStats& stats)
+{
+	std::ifstream file;
+	std::unique_ptr<InputSource> source(openSource(fname, file));
+
+	const char* begin;
+	const char* end;
+
+	while (source->next(begin, end))
+	{
+		while (begin != end)
+		{
+			Block block;
+			if (!recycled.tryPop(block))
+			{
+				block.reserve(PIPELINE_BLOCK_SIZE);
+			}
+
+			const std::size_t n = std::min<std::size_t>(PIPELINE_BLOCK_SIZE, end - begin);
+			block.assign(begin, begin + n);
+			begin += n;
+
+			++stats.items;
+			stats.bytes += n;
+
+			if (!blocks.push(std::move(block), stats))
+			{
+				throw Cancelled();
+			}
+		}
+	}
+
+	blocks.close();
+}
+
+/* the lexer and the table list it fills: flex calls the list from its rules,
+   so tokenising and building the tables can't be taken apart
+*/
+
+void
+scanStage(SPSCQueue<Block>& blocks, SPSCQueue<Block>& recycled, SPSCQueue<std::unique_ptr<SQLTable> >& tables,
+	bool skipModifiedTimestamps, StageStats& stats, std::ostream& log)
+{
+	QueueInputSource source(blocks, recycled, stats);
+	SQLLexer lex(source, skipModifiedTimestamps, 1, 0, log);
+
+	lex.tables().setTableHandler([&] (SQLTable& table) {
+		++stats.items;
+
+		std::unique_ptr<SQLTable> owned(new SQLTable(std::move(table)));
+		if (!tables.push(std::move(owned), stats))
+		{
+			throw Cancelled();
+		}
+	});
+
+	lex.parse();
+
+	tables.close();
+}
+
+void
+diffStage(SPSCQueue<std::unique_ptr<SQLTable> >& tables, SPSCQueue<TableOps>& diffs, SQLFileParser& parser, StageStats& stats)
+{
+	std::unique_ptr<SQLTable> table;
+
+	while (tables.pop(table, stats))
+	{
+		TableOps item;
+		parser.compareTable(*table, item.ops);
+		item.table = std::move(table);
+
+		++stats.items;
+
+		if (!diffs.push(std::move(item), stats))
+		{
+			throw Cancelled();
+		}
+	}
+
+	diffs.close();
+}
+
+/* every table is written out as soon as it is here
+*/
+
+void
+writeStage(SPSCQueue<TableOps>& diffs, DiffEmitter& emitter, OutputSink& sink, StageStats& stats)
+{
+	const std::uint64_t written = sink.written();
+	TableOps item;
+
+	while (diffs.pop(item, stats))
+	{
+		for (DiffOpList::const_iterator it = item.ops.begin() ; it != item.ops.end() ; ++it)
+		{
+			emitter.emit(*it);
+		}
+
+		++stats.items;
+		sink.flush();
+	}
+
+	stats.bytes = sink.written() - written;
+}
+
+} // anonymous namespace
+
+void
+backoff(unsigned int& rounds)
+{
+/* the first rounds only spin
+*/
+
+	if (rounds >= 256)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+	else if (rounds >= 64)
+	{
+		std::this_thread::yield();
+	}
+
+	++rounds;
+}
+
+void
+StageStats::report(std::ostream& log) const
+{
+	const double totalSeconds = std::chrono::duration<double>(total).count();
+	const double busySeconds = std::chrono::duration<double>(total - waited).count();
+
+	log << "pipeline " << std::left << std::setw(8) << name << std::right
+		<< std::fixed << std::setprecision(2)
+		<< items << " " << unit;
+
+	if (bytes > 0)
+	{
+		log << ", " << bytes / 1048576.0 << " MB";
+	}
+
+	log << ", busy " << busySeconds << " s of " << totalSeconds << " s";
+
+	if (busySeconds > 0)
+	{
+		if (bytes > 0)
+		{
+			log << " (" << bytes / 1048576.0 / busySeconds << " MB/s)";
+		}
+		else
+		{
+			log << " (" << items / busySeconds << " " << unit << "/s)";
+		}
+	}
+
+	log << std::defaultfloat << std::endl;
+}
+
+void
+diffPipelined(const std::string& fname, bool skipModifiedTimestamps, SQLFileParser& parser,
+	DiffEmitter& emitter, OutputSink& sink, std::ostream& log)
+{
+	SPSCQueue<Block> blocks(PIPELINE_BLOCK_COUNT), recycled(PIPELINE_BLOCK_COUNT + 2);
+	SPSCQueue<std::unique_ptr<SQLTable> > tables(PIPELINE_TABLE_COUNT);
+	SPSCQueue<TableOps> diffs(PIPELINE_TABLE_COUNT);
+
+	StageStats stats[4] = {
+		StageStats("reader", "blocks"),
+		StageStats("scanner", "tables"),
+		StageStats("differ", "tables"),
+		StageStats("writer", "tables")
+	};
+
+/* the first error of the chain is the one to report: the stages after it only
+   see their input end early
+*/
+
+	std::exception_ptr errors[4];
+
+	auto cancelAll = [&] {
+		blocks.cancel();
+		recycled.cancel();
+		tables.cancel();
+		diffs.cancel();
+	};
+
+	auto runStage = [&] (std::size_t i, const std::function<void()>& body) {
+		const PipelineClock::time_point start(PipelineClock::now());
+
+		try
+		{
+			body();
+		}
+		catch(Cancelled&)
+		{
+		}
+		catch(...)
+		{
+			errors[i] = std::current_exception();
+			cancelAll();
+		}
+
+		stats[i].total = PipelineClock::now() - start;
+	};
+
+	std::thread reader([&] {
+		runStage(0, [&] { readStage(fname, blocks, recycled, stats[0]); });
+	});
+
+	std::thread scanner([&] {
+		runStage(1, [&] { scanStage(blocks, recycled, tables, skipModifiedTimestamps, stats[1], log); });
+	});
+
+	std::thread differ([&] {
+		runStage(2, [&] { diffStage(tables, diffs, parser, stats[2]); });
+	});
+
+	runStage(3, [&] { writeStage(diffs, emitter, sink, stats[3]); });
+
+	reader.join();
+	scanner.join();
+	differ.join();
+
+	for (std::size_t i = 0 ; i < 4 ; ++i)
+	{
+		if (errors[i])
+		{
+			std::rethrow_exception(errors[i]);
+		}
+	}
+
+	for (std::size_t i = 0 ; i < 4 ; ++i)
+	{
+		stats[i].report(log);
+	}
+}
+
+} //namespace
@@ -0,0 +1,220 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "DiffEmitter.hpp"
+#include "OutputSink.hpp"
+#include "SQLFileParser.hpp"
+
+namespace sqlfileparser
+{
+
+typedef std::chrono::steady_clock PipelineClock;
+
+/* what a stage did: written by its own thread only, read once it is over; the
+   time spent waiting on the queues is what it didn't spend working
+*/
+
+struct StageStats {
+
+	StageStats(const char* n, const char* u)
+	:name(n),
+	unit(u),
+	items(0),
+	bytes(0),
+	total(),
+	waited()
+	{
+	}
+
+	void report(std::ostream& log) const;
+
+	const char* name;
+
+	const char* unit;
+
+	std::uint64_t items, bytes;
+
+	PipelineClock::duration total, waited;
+};
+
+/* spins first, then yields, then sleeps a little, "rounds" telling how long we
+   have been waiting already
+*/
+
+	void backoff(unsigned int& rounds);
+
+/* a bounded queue between two threads, one pushing and one popping, with no
+   lock: a full queue makes push() wait, an empty one pop(), which is what
+   slows a stage down to the pace of its neighbours.
+   close() is the end of the data; cancel() makes both sides give up, after an
+   error somewhere else.
+*/
+
+template<class T>
+class SPSCQueue
+{
+	public:
+
+		SPSCQueue(std::size_t capacity)
+		:slots_(capacity + 1),
+		head_(0),
+		tail_(0),
+		closed_(false),
+		cancelled_(false)
+		{
+		}
+
+/* false if the queue was cancelled: nobody will ever take the value
+*/
+
+		bool push(T&& value, StageStats& stats)
+		{
+			const std::size_t tail = tail_.load(std::memory_order_relaxed);
+			const std::size_t next = (tail + 1) % slots_.size();
+
+			if (next == head_.load(std::memory_order_acquire))
+			{
+				const PipelineClock::time_point start(PipelineClock::now());
+				unsigned int rounds = 0;
+
+				while (next == head_.load(std::memory_order_acquire))
+				{
+					if (cancelled_.load(std::memory_order_acquire))
+					{
+						return false;
+					}
+					backoff(rounds);
+				}
+
+				stats.waited += PipelineClock::now() - start;
+			}
+
+			slots_[tail] = std::move(value);
+			tail_.store(next, std::memory_order_release);
+
+			return true;
+		}
+
+/* false if the queue is full; the value is left alone then
+*/
+
+		bool tryPush(T& value)
+		{
+			const std::size_t tail = tail_.load(std::memory_order_relaxed);
+			const std::size_t next = (tail + 1) % slots_.size();
+
+			if (next == head_.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			slots_[tail] = std::move(value);
+			tail_.store(next, std::memory_order_release);
+
+			return true;
+		}
+
+/* false at the end of the data, or if the queue was cancelled
+*/
+
+		bool pop(T& value, StageStats& stats)
+		{
+			const std::size_t head = head_.load(std::memory_order_relaxed);
+
+			if (head == tail_.load(std::memory_order_acquire))
+			{
+				const PipelineClock::time_point start(PipelineClock::now());
+				unsigned int rounds = 0;
+
+				while (head == tail_.load(std::memory_order_acquire))
+				{
+
+/* whatever was pushed before close() is visible once we see it closed
+*/
+
+					if (cancelled_.load(std::memory_order_acquire) ||
+						(closed_.load(std::memory_order_acquire) && head == tail_.load(std::memory_order_acquire)))
+					{
+						stats.waited += PipelineClock::now() - start;
+						return false;
+					}
+					backoff(rounds);
+				}
+
+				stats.waited += PipelineClock::now() - start;
+			}
+
+			value = std::move(slots_[head]);
+			head_.store((head + 1) % slots_.size(), std::memory_order_release);
+
+			return true;
+		}
+
+/* false if the queue is empty
+*/
+
+		bool tryPop(T& value)
+		{
+			const std::size_t head = head_.load(std::memory_order_relaxed);
+
+			if (head == tail_.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			value = std::move(slots_[head]);
+			head_.store((head + 1) % slots_.size(), std::memory_order_release);
+
+			return true;
+		}
+
+		void close() { closed_.store(true, std::memory_order_release); }
+
+		void cancel() { cancelled_.store(true, std::memory_order_release); }
+
+	private:
+
+		SPSCQueue(const SPSCQueue&);
+
+		SPSCQueue& operator=(const SPSCQueue&);
+
+/* one slot stays empty, telling a full queue from an empty one; head and tail
+   are moved by different threads, so they don't share a cache line
+*/
+
+		std::vector<T> slots_;
+
+		alignas(64) std::atomic<std::size_t> head_;
+
+		alignas(64) std::atomic<std::size_t> tail_;
+
+		alignas(64) std::atomic<bool> closed_;
+
+		std::atomic<bool> cancelled_;
+};
+
+/* the streaming diff (see SQLFileParser::streamTable()) with every step of the
+   second version on a thread of its own: reading the file, scanning it into
+   tables, comparing them and writing the statements out (on the calling
+   thread). What each stage did is reported to "log" at the end.
+   The caller still has to call parser.finish() for the dropped tables.
+*/
+
+	void diffPipelined(const std::string& fname, bool skipModifiedTimestamps, SQLFileParser& parser,
+		DiffEmitter& emitter, OutputSink& sink, std::ostream& log);
+
+} // namespace
+
+#endif
@@ -0,0 +1,115 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "configure.h"
+#endif
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <unistd.h>
+
+#include "ResultCache.hpp"
+#include "Hash.hpp"
+#include "InputSource.hpp"
+
+namespace sqlfileparser
+{
+
+std::string
+resultCacheFile(const std::string& cacheDir, const std::string& fname1, const std::string& fname2, const std::string& options)
+{
+	if (fname1 == "-" || fname2 == "-" || !MappedInputSource::canMap(fname1) || !MappedInputSource::canMap(fname2))
+	{
+		return std::string();
+	}
+
+	const Hash128 contents1 = hashFile(fname1), contents2 = hashFile(fname2);
+
+	Hasher128 hasher;
+	hasher.number(contents1.lo);
+	hasher.number(contents1.hi);
+	hasher.number(contents2.lo);
+	hasher.number(contents2.hi);
+#ifdef VERSION
+	hasher.field(VERSION);
+#endif
+	hasher.field(options);
+
+	return (std::filesystem::path(cacheDir) / (hasher.digest().hex() + ".sql")).string();
+}
+
+bool
+isCachedResult(const std::string& cacheFile)
+{
+	return MappedInputSource::canMap(cacheFile);
+}
+
+void
+printCachedResult(const std::string& cacheFile, std::ostream& out)
+{
+	std::ifstream input(cacheFile.c_str(), std::ios::binary);
+	if (!input.is_open())
+	{
+		throw std::runtime_error("cannot open file " + cacheFile + " for reading.");
+	}
+
+	std::vector<char> buffer(1 << 20);
+
+	while (input.good())
+	{
+		input.read(&buffer[0], buffer.size());
+		out.write(&buffer[0], input.gcount());
+	}
+
+	if (input.bad())
+	{
+		throw std::runtime_error("error while reading file " + cacheFile + ".");
+	}
+}
+
+/* written aside and renamed, so a concurrent run never reads half a script
+*/
+
+ResultCacheWriter::ResultCacheWriter(const std::string& cacheFile)
+:cacheFile_(cacheFile),
+tmpname_(cacheFile + ".tmp" + std::to_string(::getpid())),
+out_(),
+committed_(false)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(cacheFile).parent_path(), ec);
+
+	out_.open(tmpname_.c_str(), std::ios::binary);
+}
+
+ResultCacheWriter::~ResultCacheWriter()
+{
+	if (!committed_)
+	{
+		out_.close();
+		std::remove(tmpname_.c_str());
+	}
+}
+
+void
+ResultCacheWriter::commit()
+{
+	out_.close();
+
+	if (!out_.good() || std::rename(tmpname_.c_str(), cacheFile_.c_str()) != 0)
+	{
+		std::remove(tmpname_.c_str());
+		committed_ = true;
+		throw std::runtime_error("cannot write file " + cacheFile_ + ".");
+	}
+
+	committed_ = true;
+}
+
+} //namespace
@@ -0,0 +1,62 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef RESULTCACHE_HPP
+#define RESULTCACHE_HPP
+
+#include <fstream>
+#include <ostream>
+#include <string>
+
+namespace sqlfileparser
+{
+
+/* the upgrade scripts already generated, in a directory, named after the hash
+   of both inputs, of the package version and of "options" (every command line
+   option that changes the output, as written on the command line).
+   Returns an empty name when one of the inputs is not a regular file (stdin,
+   a directory...), such runs aren't cached.
+*/
+
+	std::string resultCacheFile(const std::string& cacheDir, const std::string& fname1, const std::string& fname2, const std::string& options);
+
+	bool isCachedResult(const std::string& cacheFile);
+
+	void printCachedResult(const std::string& cacheFile, std::ostream& out);
+
+/* stores a script for the next runs while it is being generated, so it never
+   has to be held in memory: it goes to stream(), a temporary file next to
+   cacheFile, which commit() renames into place (throwing if anything failed).
+   Without a commit() the temporary file is removed, nothing gets cached.
+   Concurrent runs writing the same file are fine.
+*/
+
+class ResultCacheWriter
+{
+	public:
+
+		ResultCacheWriter(const std::string& cacheFile);
+
+		~ResultCacheWriter();
+
+		std::ostream& stream() { return out_; }
+
+		void commit();
+
+	private:
+
+		ResultCacheWriter(const ResultCacheWriter&);
+
+		ResultCacheWriter& operator=(const ResultCacheWriter&);
+
+		const std::string cacheFile_, tmpname_;
+
+		std::ofstream out_;
+
+		bool committed_;
+};
+
+} // namespace
+
+#endif
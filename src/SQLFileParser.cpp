@@ -2,147 +2,458 @@
 * License: GPL
 */
 
+#include <algorithm>
 #include <sstream>
 #include <string>
 
 #include "SQLFileParser.hpp"
+#include "ColumnDescriptor.hpp"
+#include "Similarity.hpp"
+#include "Parallel.hpp"
 
 namespace sqlfileparser
 {
 
-SQLFileParser::SQLFileParser(const SQLTableListManagerPtr& psm1, const SQLTableListManagerPtr& psm2)
-:psm1_(psm1),
-psm2_(psm2),
-tableCommands_(),
-tableDropCommands_(),
-fieldCommands_(),
-fieldDropCommands_(),
-keyCommands_()
+namespace
 {
-	parseTables();
-}
 
-void
-SQLFileParser::print(std::ostream& out)
+/* flags the elements of the longest strictly increasing subsequence of "seq"
+   (O(n log n)): the columns to leave in place
+*/
+
+std::vector<bool>
+longestIncreasing(const std::vector<std::size_t>& seq)
 {
+	const std::size_t none = static_cast<std::size_t>(-1);
 
-/* We generated the result into indexed structures but we need to print everything
-   out in the order we received the input (that is the table order in the second .sql file
+/* tails[k]: the index of the smallest last element of an increasing
+   subsequence of length k + 1 found so far
 */
 
-	for(SQLTableRawList::const_iterator it = psm2_->rawtlist().begin() ; it != psm2_->rawtlist().end() ; ++it)
+	std::vector<std::size_t> tails;
+	std::vector<std::size_t> previous(seq.size(), none);
+
+	for (std::size_t i = 0 ; i < seq.size() ; ++i)
 	{
+		std::vector<std::size_t>::iterator it = std::lower_bound(tails.begin(), tails.end(), seq[i],
+			[&seq] (std::size_t tail, std::size_t value) { return seq[tail] < value; });
 
-/* create table statements, if any
-*/
+		if (it != tails.begin())
+		{
+			previous[i] = *(it - 1);
+		}
 
-		TableCommandsMap::const_iterator tit = tableCommands_.find(it->name);
-		if (tit != tableCommands_.end())
+		if (it == tails.end())
 		{
-			out << tit->second;
-			continue;
+			tails.push_back(i);
+		}
+		else
+		{
+			*it = i;
 		}
+	}
+
+	std::vector<bool> keep(seq.size(), false);
+	for (std::size_t i = tails.empty() ? none : tails.back() ; i != none ; i = previous[i])
+	{
+		keep[i] = true;
+	}
 
-/* alter table add column / modify column, if any
+	return keep;
+}
+
+/* the text of one table seldom takes more
 */
 
-		FieldCommandsMap::const_iterator fit = fieldCommands_.find(it->name);
-		if (fit != fieldCommands_.end())
+const std::size_t PART_BLOCK_SIZE = 1 << 12;
+
+} // anonymous namespace
+
+/* the operations of one table in the three groups they are printed in: the
+   column ones in the order of the new columns (slots[i] is the operation of
+   the column at position i, if any), then the keys, then the dropped columns
+   (mind the order: first the constraint, then the column!)
+*/
+
+struct SQLFileParser::TableDiff {
+
+	TableDiff(std::size_t columns)
+	:fields(),
+	slots(columns, SQLTable::NOPOSITION),
+	keys(),
+	drops()
+	{
+	}
+
+	void addField(std::size_t position, const DiffOp& op)
+	{
+		slots[position] = fields.size();
+		fields.push_back(op);
+	}
+
+	DiffOpList fields;
+
+	std::vector<std::size_t> slots;
+
+	DiffOpList keys, drops;
+};
+
+SQLFileParser::SQLFileParser(const SQLTableListManagerPtr& psm1, const SQLTableListManagerPtr& psm2, unsigned int threads,
+	double renameThreshold, bool tableRenames)
+:psm1_(psm1),
+psm2_(psm2),
+pool_(StringPool::shared()),
+renameThreshold_(renameThreshold),
+threads_(threads),
+ops_(),
+seen_()
+{
+	parseTables(threads, tableRenames);
+}
+
+SQLFileParser::SQLFileParser(const SQLTableListManagerPtr& psm1, double renameThreshold)
+:psm1_(psm1),
+psm2_(),
+pool_(StringPool::shared()),
+renameThreshold_(renameThreshold),
+threads_(1),
+ops_(),
+seen_()
+{
+}
+
+void
+SQLFileParser::print(DiffEmitter& emitter) const
+{
+	emitter.begin();
+
+/* a table defined twice has its operations twice, one after the other: they
+   go to the same part, as they would go in the same statement
+*/
+
+	std::vector<std::size_t> starts;
+	for (std::size_t i = 0 ; i < ops_.size() ; ++i)
+	{
+		if (i == 0 || ops_[i].table->name != ops_[i - 1].table->name)
 		{
-			for(TableNodeList::const_iterator mit = it->fields.begin() ; mit != it->fields.end() ; ++mit)
+			starts.push_back(i);
+		}
+	}
+
+	std::vector<std::unique_ptr<DiffEmitter> > parts(starts.size());
+	std::vector<std::string> texts(starts.size());
+
+	if (threads_ > 1 && starts.size() > 1)
+	{
+		parallelFor(starts.size(), threads_, [&] (std::size_t t) {
+			std::ostringstream text;
+			OutputSink sink(text, PART_BLOCK_SIZE);
+
+			parts[t] = emitter.part(sink);
+			if (!parts[t])
 			{
-				FieldCommand::const_iterator sit = fit->second.find(*mit);
-				if (sit != fit->second.end())
-				{
-					out << sit->second;
-				}
+				return;
 			}
-		}
 
-/* alter table add constraints, keys, indexes... , if any
-   alter table drop constraints, keys, indexes... , if any
+			const std::size_t end = (t + 1 < starts.size()) ? starts[t + 1] : ops_.size();
+			for (std::size_t i = starts[t] ; i < end ; ++i)
+			{
+				parts[t]->emit(ops_[i]);
+			}
+			parts[t]->flush();
+			sink.flush();
+
+			texts[t] = text.str();
+		});
+	}
+
+/* an emitter that can't be split gets every operation here
 */
 
-		KeyCommandsMap::const_iterator pit = keyCommands_.find(it->name);
-		if (pit != keyCommands_.end())
+	if (parts.empty() || !parts[0])
+	{
+		for (DiffOpList::const_iterator it = ops_.begin() ; it != ops_.end() ; ++it)
 		{
-			out << pit->second;
+			emitter.emit(*it);
 		}
+	}
+	else
+	{
+		for (std::size_t t = 0 ; t < parts.size() ; ++t)
+		{
+			emitter.join(*parts[t], texts[t]);
+			std::string().swap(texts[t]);
+		}
+	}
+
+	emitter.end();
+}
+
+void
+SQLFileParser::parseTables(unsigned int threads, bool tableRenames)
+{
+	const SQLTableRawList& rawtlist = psm2_->rawtlist();
 
-/* alter table drop column, if any (mind the order: first the constraint, then the column!)
+/* everything is generated in the order we received the input (that is the
+   table order in the second .sql file): every table gets its own list, filled
+   by whichever thread gets to it, and the lists are put together in that order
 */
 
-		FieldDropCommandsMap::const_iterator fdit = fieldDropCommands_.find(it->name);
-		if (fdit != fieldDropCommands_.end())
-		{
-			out << fdit->second;
-		}
+	std::vector<DiffOpList> tableOps(rawtlist.size());
+
+	parallelFor(rawtlist.size(), threads, [&] (std::size_t i) {
+		parseTable(**psm2_->tlist().find(&rawtlist[i]), tableOps[i]);
+	});
+
+	std::set<const SQLTable*> renamed;
+	if (tableRenames)
+	{
+		renameTables(tableOps, renamed, threads);
+	}
+
+	for (std::vector<DiffOpList>::iterator it = tableOps.begin() ; it != tableOps.end() ; ++it)
+	{
+		ops_.insert(ops_.end(), it->begin(), it->end());
 	}
 
 /* last: drop table statements
 */
 
-	out << tableDropCommands_;
+	for (SQLTableList::const_iterator v1_it = psm1_->tlist().begin() ; v1_it != psm1_->tlist().end() ; ++v1_it)
+	{
+		if (psm2_->tlist().find(*v1_it) == psm2_->tlist().end() && renamed.count(*v1_it) == 0)
+		{
+			ops_.push_back(DiffOp(DROP_TABLE, **v1_it));
+		}
+	}
 }
 
+/* the created tables that are dropped ones renamed get, instead of their
+   create table, the rename followed by whatever else changed; all of these
+   statements are about the new name, the drops included. A table defined
+   twice is renamed at its first definition only. The dropped tables renamed
+   go into "renamed".
+*/
+
 void
-SQLFileParser::parseTables()
+SQLFileParser::renameTables(std::vector<DiffOpList>& tableOps, std::set<const SQLTable*>& renamed, unsigned int threads) const
 {
-	SQLTableList::const_iterator v1_it = psm1_->tlist().begin();
-	SQLTableList::const_iterator v2_it = psm2_->tlist().begin();
+	const SQLTableRawList& rawtlist = psm2_->rawtlist();
 
-/* we go through both indexed structures at once (complexity O(n))
-*/
+	std::vector<const SQLTable*> dropped, created;
+	std::vector<std::size_t> createdAt;
 
-	while( v1_it != psm1_->tlist().end() || v2_it != psm2_->tlist().end() )
+	for (std::size_t i = 0 ; i < rawtlist.size() ; ++i)
 	{
-		if ( v2_it == psm2_->tlist().end() )
+		const SQLTable* table = *psm2_->tlist().find(&rawtlist[i]);
+		if (table == &rawtlist[i] && psm1_->tlist().find(table) == psm1_->tlist().end())
 		{
-			printDropTableCommand(*(v1_it++));
-			continue;
+			created.push_back(table);
+			createdAt.push_back(i);
 		}
+	}
 
-		if ( v1_it == psm1_->tlist().end() )
+	for (SQLTableList::const_iterator v1_it = psm1_->tlist().begin() ; v1_it != psm1_->tlist().end() ; ++v1_it)
+	{
+		if (psm2_->tlist().find(*v1_it) == psm2_->tlist().end())
 		{
-			printCreateTableCommand(*(v2_it++));
-			continue;
+			dropped.push_back(*v1_it);
+		}
+	}
+
+	if (dropped.empty() || created.empty())
+	{
+		return;
+	}
+
+	const std::vector<std::pair<std::size_t, std::size_t> > renames(findRenamedTables(dropped, created, threads));
+	std::set<const SQLTable*> renamedTo;
+
+	for (std::vector<std::pair<std::size_t, std::size_t> >::const_iterator it = renames.begin() ; it != renames.end() ; ++it)
+	{
+		const SQLTable& ref1 = *dropped[it->first];
+		const SQLTable& ref2 = *created[it->second];
+		DiffOpList& ops = tableOps[createdAt[it->second]];
+
+		ops.clear();
+
+		DiffOp rename(RENAME_TABLE, ref2);
+		rename.oldName = ref1.name;
+		rename.before = &ref1;
+		rename.after = &ref2;
+		ops.push_back(rename);
+
+		if (ref1.fingerprint != ref2.fingerprint)
+		{
+			diffTable(ref1, ref2, ops);
 		}
 
-		if ( v1_it->name < v2_it->name )
+		for (DiffOpList::iterator op = ops.begin() ; op != ops.end() ; ++op)
 		{
-			printDropTableCommand(*(v1_it++));
-			continue;
+			op->table = &ref2;
 		}
 
-		if ( v1_it->name > v2_it->name )
+		renamed.insert(&ref1);
+		renamedTo.insert(&ref2);
+	}
+
+	for (std::size_t i = 0 ; i < rawtlist.size() ; ++i)
+	{
+		const SQLTable* table = *psm2_->tlist().find(&rawtlist[i]);
+		if (table != &rawtlist[i] && renamedTo.count(table) != 0)
 		{
-			printCreateTableCommand(*(v2_it++));
-			continue;
+			tableOps[i].clear();
 		}
+	}
+}
 
-		fieldCommands_.insert(std::make_pair(v1_it->name, FieldCommand()));
-		fieldDropCommands_.insert(std::make_pair(v1_it->name, std::string()));
-		parseFields(*(v1_it), *(v2_it));
+/* a table defined twice is taken as its first definition, both times (the
+   one in the name index)
+*/
+
+void
+SQLFileParser::parseTable(const SQLTable& ref2, DiffOpList& ops) const
+{
+	SQLTableList::const_iterator v1_it = psm1_->tlist().find(&ref2);
+	if (v1_it == psm1_->tlist().end())
+	{
+		ops.push_back(DiffOp(CREATE_TABLE, ref2));
+		return;
+	}
 
-		keyCommands_.insert(std::make_pair(v1_it->name, std::string()));
-		parsePrimary(*(v1_it), *(v2_it));
-		parseForeign(*(v1_it), *(v2_it));
-		parseIndex(*(v1_it), *(v2_it));
-		parseUnique(*(v1_it), *(v2_it));
-		parseFullText(*(v1_it), *(v2_it));
-		parseSpatial(*(v1_it), *(v2_it));
+/* identical tables: nothing to compare
+*/
 
-		++v1_it;
-		++v2_it;
+	if ((*v1_it)->fingerprint != ref2.fingerprint)
+	{
+		diffTable(**v1_it, ref2, ops);
 	}
 }
 
 void
-SQLFileParser::parseFields(const SQLTable& ref1, const SQLTable& ref2)
+SQLFileParser::streamTable(const SQLTable& ref2, DiffEmitter& emitter)
+{
+
+/* the operations point into ref2, which is gone once we return
+*/
+
+	DiffOpList ops;
+	compareTable(ref2, ops);
+
+	for (DiffOpList::const_iterator it = ops.begin() ; it != ops.end() ; ++it)
+	{
+		emitter.emit(*it);
+	}
+}
+
+void
+SQLFileParser::compareTable(const SQLTable& ref2, DiffOpList& ops)
+{
+	parseTable(ref2, ops);
+
+	SQLTableList::const_iterator v1_it = psm1_->tlist().find(&ref2);
+	if (v1_it != psm1_->tlist().end())
+	{
+		seen_.insert(*v1_it);
+	}
+}
+
+void
+SQLFileParser::finish(DiffEmitter& emitter) const
+{
+	for (SQLTableList::const_iterator v1_it = psm1_->tlist().begin() ; v1_it != psm1_->tlist().end() ; ++v1_it)
+	{
+		if (seen_.find(*v1_it) == seen_.end())
+		{
+			emitter.emit(DiffOp(DROP_TABLE, **v1_it));
+		}
+	}
+}
+
+void
+SQLFileParser::diffTable(const SQLTable& ref1, const SQLTable& ref2, DiffOpList& ops) const
+{
+	TableDiff diff(ref2.fields.size());
+	const std::size_t first = ops.size();
+
+	parseFields(ref1, ref2, diff);
+
+	parsePrimary(ref1, ref2, diff);
+	parseForeign(ref1, ref2, diff);
+	parseIndex(ref1, ref2, diff);
+	parseUnique(ref1, ref2, diff);
+	parseFullText(ref1, ref2, diff);
+	parseSpatial(ref1, ref2, diff);
+
+	for (TableNodeList::const_iterator it = ref2.fields.begin() ; it != ref2.fields.end() ; ++it)
+	{
+		std::size_t slot = diff.slots[ref2.position(*it)];
+		if (slot != SQLTable::NOPOSITION)
+		{
+			ops.push_back(diff.fields[slot]);
+		}
+	}
+
+	ops.insert(ops.end(), diff.keys.begin(), diff.keys.end());
+	ops.insert(ops.end(), diff.drops.begin(), diff.drops.end());
+
+	for (DiffOpList::iterator it = ops.begin() + first ; it != ops.end() ; ++it)
+	{
+		it->before = &ref1;
+		it->after = &ref2;
+	}
+}
+
+void
+SQLFileParser::parseFields(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const
 {
 	TableNodeMap::const_iterator fit1 = ref1.indexedfields.begin();
 	TableNodeMap::const_iterator fit2 = ref2.indexedfields.begin();
 
+	const std::vector<std::size_t> renamed(findRenamedFields(ref1, ref2));
+	const std::vector<bool> moved(findMovedFields(ref1, ref2, renamed));
+
+	std::vector<bool> renamedFrom(ref1.fields.size(), false);
+	for (std::size_t i = 0 ; i < renamed.size() ; ++i)
+	{
+		if (renamed[i] != SQLTable::NOPOSITION)
+		{
+			renamedFrom[renamed[i]] = true;
+		}
+	}
+
+	const TableCharset charset1(describeTableCharset(ref1.tabletype, *pool_));
+	const TableCharset charset2(describeTableCharset(ref2.tabletype, *pool_));
+
+/* a column only in the first version is dropped, one only in the second added,
+   unless they are the same column renamed
+*/
+
+	auto dropField = [&] () {
+		if (!renamedFrom[ref1.positions[fit1 - ref1.indexedfields.begin()]])
+		{
+			diff.drops.push_back(DiffOp(DROP_COLUMN, ref1, *fit1));
+		}
+		++fit1;
+	};
+
+	auto addField = [&] () {
+		const std::size_t position = ref2.positions[fit2 - ref2.indexedfields.begin()];
+
+		if (renamed[position] == SQLTable::NOPOSITION)
+		{
+			diff.addField(position, DiffOp(ADD_COLUMN, ref2, *fit2));
+		}
+		else
+		{
+			DiffOp op(RENAME_COLUMN, ref2, *fit2);
+			op.oldName = ref1.fields[renamed[position]];
+			op.moved = moved[position];
+			diff.addField(position, op);
+		}
+		++fit2;
+	};
+
 /* we go through both indexed structures at once (complexity O(n))
 */
 
@@ -150,31 +461,45 @@ SQLFileParser::parseFields(const SQLTable& ref1, const SQLTable& ref2)
 	{
 		if ( fit2 == ref2.indexedfields.end() )
 		{
-			printAlterDropCommand(ref1, (fit1++)->first);
+			dropField();
 			continue;
 		}
 
 		if ( fit1 == ref1.indexedfields.end() )
 		{
-			printAlterAddCommand(ref2, *(fit2++));
+			addField();
 			continue;
 		}
 
 		if ( fit1->first < fit2->first )
 		{
-			printAlterDropCommand(ref1, (fit1++)->first);
+			dropField();
 			continue;
 		}
 
 		if ( fit1->first > fit2->first )
 		{
-			printAlterAddCommand(ref2, *(fit2++));
+			addField();
 			continue;
 		}
 
-		if ( fit1->second != fit2->second )
+		const std::size_t position = ref2.positions[fit2 - ref2.indexedfields.begin()];
+
+/* the same text is the same column; different texts may still say the same
+   thing ("default '0'" and "default 0" on an int...), which would be a table
+   rebuild for nothing
+*/
+
+		const bool modified = fit1->second != fit2->second &&
+			describeColumn(fit1->second, charset1, *pool_) != describeColumn(fit2->second, charset2, *pool_);
+
+		if ( moved[position] )
 		{
-			printAlterModifyCommand(ref2, *fit2);
+			diff.addField(position, DiffOp(MOVE_COLUMN, ref2, *fit2, modified));
+		}
+		else if ( modified )
+		{
+			diff.addField(position, DiffOp(MODIFY_COLUMN, ref2, *fit2));
 		}
 
 		++fit1;
@@ -182,8 +507,181 @@ SQLFileParser::parseFields(const SQLTable& ref1, const SQLTable& ref2)
 	}
 }
 
+/* a dropped column and an added one with the same definition may be the same
+   column under a new name; how sure we are of it depends on where they are
+   (the same neighbours, about the same position) and on how alike their names
+   are. The pairs we are sure enough of are taken, the surest first.
+   By position in ref2: the position in ref1 of the column it renames.
+*/
+
+std::vector<std::size_t>
+SQLFileParser::findRenamedFields(const SQLTable& ref1, const SQLTable& ref2) const
+{
+	std::vector<std::size_t> renamed(ref2.fields.size(), SQLTable::NOPOSITION);
+
+	if (renameThreshold_ > 1)
+	{
+		return renamed;
+	}
+
+	std::vector<bool> dropped(ref1.fields.size(), false), added(ref2.fields.size(), false);
+	std::vector<std::size_t> drops, adds;
+
+	for (std::size_t i = 0 ; i < ref1.fields.size() ; ++i)
+	{
+		if (ref2.position(ref1.fields[i]) == SQLTable::NOPOSITION)
+		{
+			dropped[i] = true;
+			drops.push_back(i);
+		}
+	}
+
+	for (std::size_t j = 0 ; j < ref2.fields.size() ; ++j)
+	{
+		if (ref1.position(ref2.fields[j]) == SQLTable::NOPOSITION)
+		{
+			added[j] = true;
+			adds.push_back(j);
+		}
+	}
+
+	if (drops.empty() || adds.empty())
+	{
+		return renamed;
+	}
+
+	const TableCharset charset1(describeTableCharset(ref1.tabletype, *pool_));
+	const TableCharset charset2(describeTableCharset(ref2.tabletype, *pool_));
+
+/* described once each, not once per pair: describing interns strings
+*/
+
+	std::vector<ColumnDescriptor> dropDescriptors, addDescriptors;
+
+	for (std::vector<std::size_t>::const_iterator d = drops.begin() ; d != drops.end() ; ++d)
+	{
+		dropDescriptors.push_back(describeColumn(ref1.definition(ref1.fields[*d]), charset1, *pool_));
+	}
+
+	for (std::vector<std::size_t>::const_iterator a = adds.begin() ; a != adds.end() ; ++a)
+	{
+		addDescriptors.push_back(describeColumn(ref2.definition(ref2.fields[*a]), charset2, *pool_));
+	}
+
+/* the columns on both sides are the same column, or both dropped and added
+   (renamed as well, probably); so are the ends of the tables
+*/
+
+	auto sameNeighbour = [&] (std::size_t i, std::size_t j, int step) {
+		const bool end1 = (step < 0) ? i == 0 : i + 1 == ref1.fields.size();
+		const bool end2 = (step < 0) ? j == 0 : j + 1 == ref2.fields.size();
+
+		if (end1 || end2)
+		{
+			return end1 && end2;
+		}
+
+		const std::size_t n1 = i + step, n2 = j + step;
+
+		return ref1.fields[n1] == ref2.fields[n2] || (dropped[n1] && added[n2]);
+	};
+
+	struct Candidate {
+		double confidence;
+		std::size_t distance, from, to;
+	};
+
+	std::vector<Candidate> candidates;
+
+	for (std::size_t di = 0 ; di < drops.size() ; ++di)
+	{
+		const std::size_t d = drops[di];
+		const Atom& definition1 = ref1.definition(ref1.fields[d]);
+
+		for (std::size_t ai = 0 ; ai < adds.size() ; ++ai)
+		{
+			const std::size_t a = adds[ai];
+			const Atom& definition2 = ref2.definition(ref2.fields[a]);
+
+			if (definition1 != definition2 && dropDescriptors[di] != addDescriptors[ai])
+			{
+				continue;
+			}
+
+			const std::size_t distance = (d > a) ? d - a : a - d;
+			const double context = ((sameNeighbour(d, a, -1) ? 1 : 0) + (sameNeighbour(d, a, 1) ? 1 : 0)) / 2.0;
+			const double confidence = 0.4 * context + 0.3 / (1 + distance) + 0.3 * nameSimilarity(ref1.fields[d], ref2.fields[a]);
+
+			if (confidence >= renameThreshold_)
+			{
+				Candidate candidate = { confidence, distance, d, a };
+				candidates.push_back(candidate);
+			}
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [] (const Candidate& x, const Candidate& y) {
+		if (x.confidence != y.confidence)
+		{
+			return x.confidence > y.confidence;
+		}
+		if (x.distance != y.distance)
+		{
+			return x.distance < y.distance;
+		}
+		return x.from < y.from || (x.from == y.from && x.to < y.to);
+	});
+
+	std::vector<bool> taken(ref1.fields.size(), false);
+
+	for (std::vector<Candidate>::const_iterator it = candidates.begin() ; it != candidates.end() ; ++it)
+	{
+		if (!taken[it->from] && renamed[it->to] == SQLTable::NOPOSITION)
+		{
+			taken[it->from] = true;
+			renamed[it->to] = it->from;
+		}
+	}
+
+	return renamed;
+}
+
+/* the columns both versions have, taken in the new order, with their old
+   positions: the longest increasing run of those positions can stay where it
+   is, every other column has to move. Flags are indexed by position in ref2.
+   Moving them in the new order, each right after its new predecessor, gives
+   the new order (added columns are put in place the same way). Renamed columns
+   count with the position of their old name.
+*/
+
+std::vector<bool>
+SQLFileParser::findMovedFields(const SQLTable& ref1, const SQLTable& ref2, const std::vector<std::size_t>& renamed) const
+{
+	std::vector<std::size_t> common, oldPositions;
+
+	for (std::size_t i = 0 ; i < ref2.fields.size() ; ++i)
+	{
+		std::size_t oldPosition = (renamed[i] != SQLTable::NOPOSITION) ? renamed[i] : ref1.position(ref2.fields[i]);
+		if (oldPosition != SQLTable::NOPOSITION && ref2.position(ref2.fields[i]) == i)
+		{
+			common.push_back(i);
+			oldPositions.push_back(oldPosition);
+		}
+	}
+
+	const std::vector<bool> keep(longestIncreasing(oldPositions));
+
+	std::vector<bool> moved(ref2.fields.size(), false);
+	for (std::size_t i = 0 ; i < common.size() ; ++i)
+	{
+		moved[common[i]] = !keep[i];
+	}
+
+	return moved;
+}
+
 void
-SQLFileParser::parsePrimary(const SQLTable& ref1, const SQLTable& ref2)
+SQLFileParser::parsePrimary(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const
 {
 	TableIndexList::const_iterator fit1 = ref1.primary.begin();
 	TableIndexList::const_iterator fit2 = ref2.primary.begin();
@@ -192,14 +690,14 @@ SQLFileParser::parsePrimary(const SQLTable& ref1, const SQLTable& ref2)
 	{
 		if ( fit2 == ref2.primary.end() )
 		{
-			printAlterDropPrimaryCommand(ref1);
+			diff.keys.push_back(DiffOp(DROP_PRIMARY, ref1));
 			++fit1;
 			continue;
 		}
 
 		if ( fit1 == ref1.primary.end() )
 		{
-			printAlterAddPrimaryCommand(ref2, *(fit2++));
+			diff.keys.push_back(DiffOp(ADD_PRIMARY, ref2, *(fit2++)));
 			continue;
 		}
 
@@ -211,8 +709,8 @@ SQLFileParser::parsePrimary(const SQLTable& ref1, const SQLTable& ref2)
 
 		if ( *fit1 != *fit2 )
 		{
-			printAlterDropPrimaryCommand(ref1);
-			printAlterAddPrimaryCommand(ref2, *fit2);
+			diff.keys.push_back(DiffOp(DROP_PRIMARY, ref1));
+			diff.keys.push_back(DiffOp(ADD_PRIMARY, ref2, *fit2));
 		}
 
 		++fit1;
@@ -221,7 +719,7 @@ SQLFileParser::parsePrimary(const SQLTable& ref1, const SQLTable& ref2)
 }
 
 void
-SQLFileParser::parseForeign(const SQLTable& ref1, const SQLTable& ref2)
+SQLFileParser::parseForeign(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const
 {
 	TableIndexList::const_iterator fit1 = ref1.foreign.begin();
 	TableIndexList::const_iterator fit2 = ref2.foreign.begin();
@@ -230,25 +728,25 @@ SQLFileParser::parseForeign(const SQLTable& ref1, const SQLTable& ref2)
 	{
 		if ( fit2 == ref2.foreign.end() )
 		{
-			printAlterDropForeignCommand(ref1, *(fit1++));
+			diff.keys.push_back(DiffOp(DROP_FOREIGN, ref1, *(fit1++)));
 			continue;
 		}
 
 		if ( fit1 == ref1.foreign.end() )
 		{
-			printAlterAddForeignCommand(ref2, *(fit2++));
+			diff.keys.push_back(DiffOp(ADD_FOREIGN, ref2, *(fit2++)));
 			continue;
 		}
 
 		if ( fit1->first < fit2->first )
 		{
-			printAlterDropForeignCommand(ref1, *(fit1++));
+			diff.keys.push_back(DiffOp(DROP_FOREIGN, ref1, *(fit1++)));
 			continue;
 		}
 
 		if ( fit1->first > fit2->first )
 		{
-			printAlterAddForeignCommand(ref2, *(fit2++));
+			diff.keys.push_back(DiffOp(ADD_FOREIGN, ref2, *(fit2++)));
 			continue;
 		}
 
@@ -258,8 +756,8 @@ SQLFileParser::parseForeign(const SQLTable& ref1, const SQLTable& ref2)
 
 		if (fit1->first == fit2->first && fit2->second.size() > 0 && fit1->second != fit2->second)
 		{
-			printAlterDropForeignCommand(ref1, *fit1);
-			printAlterAddForeignCommand(ref2, *fit2);
+			diff.keys.push_back(DiffOp(DROP_FOREIGN, ref1, *fit1));
+			diff.keys.push_back(DiffOp(ADD_FOREIGN, ref2, *fit2));
 		}
 
 		++fit1;
@@ -268,7 +766,7 @@ SQLFileParser::parseForeign(const SQLTable& ref1, const SQLTable& ref2)
 }
 
 void
-SQLFileParser::parseIndex(const SQLTable& ref1, const SQLTable& ref2)
+SQLFileParser::parseIndex(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const
 {
 	TableIndexList::const_iterator fit1 = ref1.index.begin();
 	TableIndexList::const_iterator fit2 = ref2.index.begin();
@@ -277,13 +775,13 @@ SQLFileParser::parseIndex(const SQLTable& ref1, const SQLTable& ref2)
 	{
 		if ( fit2 == ref2.index.end() )
 		{
-			printAlterDropIndexCommand(ref1, *(fit1++));
+			diff.keys.push_back(DiffOp(DROP_INDEX, ref1, *(fit1++)));
 			continue;
 		}
 
 		if ( fit1 == ref1.index.end() )
 		{
-			printAlterAddIndexCommand(ref2, *(fit2++));
+			diff.keys.push_back(DiffOp(ADD_INDEX, ref2, *(fit2++)));
 			continue;
 		}
 
@@ -292,13 +790,13 @@ SQLFileParser::parseIndex(const SQLTable& ref1, const SQLTable& ref2)
 
 		if ( fit1->first < fit2->first )
 		{
-			printAlterDropIndexCommand(ref1, *(fit1++));
+			diff.keys.push_back(DiffOp(DROP_INDEX, ref1, *(fit1++)));
 			continue;
 		}
 
 		if ( fit1->first > fit2->first )
 		{
-			printAlterAddIndexCommand(ref2, *(fit2++));
+			diff.keys.push_back(DiffOp(ADD_INDEX, ref2, *(fit2++)));
 			continue;
 		}
 
@@ -308,7 +806,7 @@ SQLFileParser::parseIndex(const SQLTable& ref1, const SQLTable& ref2)
 }
 
 void
-SQLFileParser::parseUnique(const SQLTable& ref1, const SQLTable& ref2)
+SQLFileParser::parseUnique(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const
 {
 	TableIndexList::const_iterator fit1 = ref1.unique.begin();
 	TableIndexList::const_iterator fit2 = ref2.unique.begin();
@@ -317,25 +815,25 @@ SQLFileParser::parseUnique(const SQLTable& ref1, const SQLTable& ref2)
 	{
 		if ( fit2 == ref2.unique.end() )
 		{
-			printAlterDropUniqueCommand(ref1, *(fit1++));
+			diff.keys.push_back(DiffOp(DROP_UNIQUE, ref1, *(fit1++)));
 			continue;
 		}
 
 		if ( fit1 == ref1.unique.end() )
 		{
-			printAlterAddUniqueCommand(ref2, *(fit2++));
+			diff.keys.push_back(DiffOp(ADD_UNIQUE, ref2, *(fit2++)));
 			continue;
 		}
 
 		if ( fit1->first < fit2->first )
 		{
-			printAlterDropUniqueCommand(ref1, *(fit1++));
+			diff.keys.push_back(DiffOp(DROP_UNIQUE, ref1, *(fit1++)));
 			continue;
 		}
 
 		if ( fit1->first > fit2->first )
 		{
-			printAlterAddUniqueCommand(ref2, *(fit2++));
+			diff.keys.push_back(DiffOp(ADD_UNIQUE, ref2, *(fit2++)));
 			continue;
 		}
 
@@ -345,8 +843,8 @@ SQLFileParser::parseUnique(const SQLTable& ref1, const SQLTable& ref2)
 
 		if (fit1->first == fit2->first && fit2->second.size() > 0 && fit1->second != fit2->second)
 		{
-			printAlterDropUniqueCommand(ref1, *fit1);
-			printAlterAddUniqueCommand(ref2, *fit2);
+			diff.keys.push_back(DiffOp(DROP_UNIQUE, ref1, *fit1));
+			diff.keys.push_back(DiffOp(ADD_UNIQUE, ref2, *fit2));
 		}
 
 		++fit1;
@@ -355,7 +853,7 @@ SQLFileParser::parseUnique(const SQLTable& ref1, const SQLTable& ref2)
 }
 
 void
-SQLFileParser::parseFullText(const SQLTable& ref1, const SQLTable& ref2)
+SQLFileParser::parseFullText(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const
 {
 	TableIndexList::const_iterator fit1 = ref1.fulltext.begin();
 	TableIndexList::const_iterator fit2 = ref2.fulltext.begin();
@@ -364,13 +862,13 @@ SQLFileParser::parseFullText(const SQLTable& ref1, const SQLTable& ref2)
 	{
 		if ( fit2 == ref2.fulltext.end() )
 		{
-			printAlterDropFullTextCommand(ref1, *(fit1++));
+			diff.keys.push_back(DiffOp(DROP_FULLTEXT, ref1, *(fit1++)));
 			continue;
 		}
 
 		if ( fit1 == ref1.fulltext.end() )
 		{
-			printAlterAddFullTextCommand(ref2, *(fit2++));
+			diff.keys.push_back(DiffOp(ADD_FULLTEXT, ref2, *(fit2++)));
 			continue;
 		}
 
@@ -379,13 +877,13 @@ SQLFileParser::parseFullText(const SQLTable& ref1, const SQLTable& ref2)
 
 		if ( fit1->first < fit2->first )
 		{
-			printAlterDropFullTextCommand(ref1, *(fit1++));
+			diff.keys.push_back(DiffOp(DROP_FULLTEXT, ref1, *(fit1++)));
 			continue;
 		}
 
 		if ( fit1->first > fit2->first )
 		{
-			printAlterAddFullTextCommand(ref2, *(fit2++));
+			diff.keys.push_back(DiffOp(ADD_FULLTEXT, ref2, *(fit2++)));
 			continue;
 		}
 
@@ -395,7 +893,7 @@ SQLFileParser::parseFullText(const SQLTable& ref1, const SQLTable& ref2)
 }
 
 void
-SQLFileParser::parseSpatial(const SQLTable& ref1, const SQLTable& ref2)
+SQLFileParser::parseSpatial(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const
 {
 	TableIndexList::const_iterator fit1 = ref1.spatial.begin();
 	TableIndexList::const_iterator fit2 = ref2.spatial.begin();
@@ -404,13 +902,13 @@ SQLFileParser::parseSpatial(const SQLTable& ref1, const SQLTable& ref2)
 	{
 		if ( fit2 == ref2.spatial.end() )
 		{
-			printAlterDropSpatialCommand(ref1, *(fit1++));
+			diff.keys.push_back(DiffOp(DROP_SPATIAL, ref1, *(fit1++)));
 			continue;
 		}
 
 		if ( fit1 == ref1.spatial.end() )
 		{
-			printAlterAddSpatialCommand(ref2, *(fit2++));
+			diff.keys.push_back(DiffOp(ADD_SPATIAL, ref2, *(fit2++)));
 			continue;
 		}
 
@@ -419,13 +917,13 @@ SQLFileParser::parseSpatial(const SQLTable& ref1, const SQLTable& ref2)
 
 		if ( fit1->first < fit2->first )
 		{
-			printAlterDropSpatialCommand(ref1, *(fit1++));
+			diff.keys.push_back(DiffOp(DROP_SPATIAL, ref1, *(fit1++)));
 			continue;
 		}
 
 		if ( fit1->first > fit2->first )
 		{
-			printAlterAddSpatialCommand(ref2, *(fit2++));
+			diff.keys.push_back(DiffOp(ADD_SPATIAL, ref2, *(fit2++)));
 			continue;
 		}
 
@@ -434,299 +932,5 @@ SQLFileParser::parseSpatial(const SQLTable& ref1, const SQLTable& ref2)
 	}
 }
 
-
-/* output generators */
-
-void
-SQLFileParser::printCreateTableCommand(const SQLTable& ref)
-{
-	std::ostringstream mstr_;
-	
-	mstr_ << "create table " << ref.name
-		<< std::endl;
-
-	std::ostringstream ostr_;
-
-	for(TableNodeList::const_iterator fit = ref.fields.begin(); fit != ref.fields.end(); ++fit)
-	{
-		ostr_ << std::endl << "\t"
-			<< *fit << " " << ref.indexedfields.at(*fit)
-			<< ",";
-	}
-
-	for(TableIndexList::const_iterator pit = ref.primary.begin(); pit != ref.primary.end(); ++pit)
-	{
-		ostr_ << std::endl << "\t"
-			<< ((pit->second.size() > 0)?("constraint " + pit->second + " "):"")
-			<< "primary key " << pit->first
-			<< ",";
-	}
-
-	for(TableIndexList::const_iterator oit = ref.foreign.begin(); oit != ref.foreign.end(); ++oit)
-	{
-		ostr_ << std::endl << "\t"
-			<< ((oit->second.size() > 0)?("constraint " + oit->second + " "):"")
-			<< "foreign key " << oit->first
-			<< ",";
-	}
-
-	for(TableIndexList::const_iterator iit = ref.index.begin(); iit != ref.index.end(); ++iit)
-	{
-		ostr_ << std::endl << "\t"
-			<< "index " << ((iit->second.size() > 0)?iit->second + " ":"") << "(" << iit->first << ")"
-			<< ",";
-	}
-
-	for(TableIndexList::const_iterator uit = ref.unique.begin(); uit != ref.unique.end(); ++uit)
-	{
-		ostr_ << std::endl << "\t"
-			<< "unique " << ((uit->second.size() > 0)?uit->second + " ":"") << "(" << uit->first << ")"
-			<< ",";
-	}
-
-	for(TableIndexList::const_iterator ftit = ref.fulltext.begin(); ftit != ref.fulltext.end(); ++ftit)
-	{
-		ostr_ << std::endl << "\t"
-			<< "fulltext " << ((ftit->second.size() > 0)?ftit->second + " ":"") << "(" << ftit->first << ")"
-			<< ",";
-	}
-
-	for(TableIndexList::const_iterator sit = ref.spatial.begin(); sit != ref.spatial.end(); ++sit)
-	{
-		ostr_ << std::endl << "\t"
-			<< "spatial " << ((sit->second.size() > 0)?sit->second + " ":"") << "(" << sit->first << ")"
-			<< ",";
-	}
-
-	std::string tmpbuf(ostr_.str());
-	tmpbuf.erase(tmpbuf.length()-1, std::string::npos);
-
-	mstr_ << "(" << tmpbuf << std::endl << ") "
-		<< ref.tabletype << ";"
-		<< std::endl << std::endl;
-
-	tableCommands_.insert(std::make_pair(ref.name, mstr_.str()));
-}
-
-void
-SQLFileParser::printDropTableCommand(const SQLTable& ref)
-{
-	std::ostringstream mstr_;
-
-	mstr_ << "drop table " << ref.name << ";"
-		<< std::endl << std::endl;
-
-	tableDropCommands_.append(mstr_.str());
-}
-
-void
-SQLFileParser::printAlterModifyCommand(const SQLTable& ref, const std::pair<std::string, std::string>& rfield)
-{
-	std::ostringstream mstr_;
-
-	mstr_<< "alter table " << ref.name
-		<< " modify column " << rfield.first << " " << rfield.second << ";"
-		<< std::endl << std::endl; 
-
-	fieldCommands_.at(ref.name).insert(std::make_pair(rfield.first, mstr_.str()));
-}
-
-void
-SQLFileParser::printAlterDropCommand(const SQLTable& ref, const std::string& rfield)
-{
-	std::ostringstream mstr_;
-
-	mstr_ << "alter table " << ref.name
-		<< " drop column " << rfield << ";"
-		<< std::endl << std::endl;
-
-	fieldDropCommands_.at(ref.name).append(mstr_.str());
-}
-
-void
-SQLFileParser::printAlterAddCommand(const SQLTable& ref, const std::pair<std::string, std::string>& rfield)
-{
-	std::ostringstream mstr_;
-
-	std::string previous;
-	for(TableNodeList::const_iterator fit = ref.fields.begin() ; fit != ref.fields.end() ; ++fit)
-	{
-		if (rfield.first == *fit) break;
-		previous.assign(*fit);
-	}
-
-	std::string tmpbuf;
-	if (previous.size() > 0) tmpbuf.assign("after " + previous);
-	else tmpbuf.assign("first");
-	
-	mstr_ << "alter table " << ref.name
-		<< " add column " << rfield.first << " " << rfield.second <<  " " << tmpbuf << ";"
-		<< std::endl << std::endl;
-
-	fieldCommands_.at(ref.name).insert(std::make_pair(rfield.first, mstr_.str()));
-}
-
-void
-SQLFileParser::printAlterDropPrimaryCommand(const SQLTable& ref)
-{
-	std::ostringstream mstr_;
-
-	mstr_ << "alter table " << ref.name
-		<< " drop primary key;"
-		<< std::endl << std::endl;
-
-	keyCommands_.at(ref.name).append(mstr_.str());
-}
-
-void
-SQLFileParser::printAlterAddPrimaryCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc)
-{
-	std::ostringstream mstr_;
-
-	mstr_ << "alter table " << ref.name
-		<< " add"
-		<< ((desc.second.size() > 0)?" constraint " + desc.second:"")
-		<< " primary key " << desc.first << ";"
-		<< std::endl << std::endl;
-
-	keyCommands_.at(ref.name).append(mstr_.str());
-}
-
-void
-SQLFileParser::printAlterDropForeignCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc)
-{
-	std::ostringstream mstr_;
-
-	if (desc.second.size() > 0)
-	{
-		mstr_ << "alter table " << ref.name
-			<< " drop foreign key " << desc.second << ";"
-			<< std::endl << std::endl;
-	}
-	else
-	{
-		/* foreign key dropping can't be automatically implemented as it requires an identifier created
-		internally by the InnoDB engine */
-
-		mstr_ << "# foreign key dropping can't be automatically implemented as it " << std::endl;
-		mstr_ << "# requires an identifier created internally by the InnoDB engine." << std::endl;
-		mstr_ << "# alter table " << ref.name
-			<< " drop foreign key " << "??fk_symbol??" << "; // description: " << desc.first
-			<< std::endl << std::endl;
-	}
-
-	keyCommands_.at(ref.name).append(mstr_.str());
-}
-
-void
-SQLFileParser::printAlterAddForeignCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc)
-{
-	std::ostringstream mstr_;
-
-	mstr_ << "alter table " << ref.name
-		<< " add"
-		<< ((desc.second.size() > 0)?" constraint " + desc.second:"")
-		<< " foreign key " << desc.first << ";"
-		<< std::endl << std::endl;
-
-	keyCommands_.at(ref.name).append(mstr_.str());
-}
-
-void
-SQLFileParser::printAlterDropIndexCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc)
-{
-	std::ostringstream mstr_;
-
-	mstr_ << "alter table " << ref.name
-		<< " drop index " << desc.second << ";"
-		<< std::endl << std::endl;
-
-	keyCommands_.at(ref.name).append(mstr_.str());
-}
-
-void
-SQLFileParser::printAlterAddIndexCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc)
-{
-	std::ostringstream mstr_;
-
-	mstr_ << "alter table " << ref.name
-		<< " add index " << ((desc.second.size() > 0)?desc.second + " ":"") << "(" << desc.first << ");"
-		<< std::endl << std::endl;
-
-	keyCommands_.at(ref.name).append(mstr_.str());
-}
-
-void
-SQLFileParser::printAlterDropUniqueCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc)
-{
-	std::ostringstream mstr_;
-
-	mstr_ << "alter table " << ref.name
-		<< " drop key " << desc.second << ";"
-		<< std::endl << std::endl;
-
-	keyCommands_.at(ref.name).append(mstr_.str());
-}
-
-void
-SQLFileParser::printAlterAddUniqueCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc)
-{
-	std::ostringstream mstr_;
-
-	mstr_ << "alter table " << ref.name
-		<< " add unique " << ((desc.second.size() > 0)?desc.second + " ":"") << "(" << desc.first << ");"
-		<< std::endl << std::endl;
-
-	keyCommands_.at(ref.name).append(mstr_.str());
-}
-
-void
-SQLFileParser::printAlterDropFullTextCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc)
-{
-	std::ostringstream mstr_;
-
-	mstr_ << "alter table " << ref.name
-		<< " drop key " << desc.second << ";"
-		<< std::endl << std::endl;
-
-	keyCommands_.at(ref.name).append(mstr_.str());
-}
-
-void
-SQLFileParser::printAlterAddFullTextCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc)
-{
-	std::ostringstream mstr_;
-
-	mstr_ << "alter table " << ref.name
-		<< " add fulltext " << ((desc.second.size() > 0)?desc.second + " ":"") << "(" << desc.first << ");"
-		<< std::endl << std::endl;
-
-	keyCommands_.at(ref.name).append(mstr_.str());
-}
-
-void
-SQLFileParser::printAlterDropSpatialCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc)
-{
-	std::ostringstream mstr_;
-
-	mstr_ << "alter table " << ref.name
-		<< " drop key " << desc.second << ";"
-		<< std::endl << std::endl;
-
-	keyCommands_.at(ref.name).append(mstr_.str());
-}
-
-void
-SQLFileParser::printAlterAddSpatialCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc)
-{
-	std::ostringstream mstr_;
-
-	mstr_ << "alter table " << ref.name
-		<< " add spatial " << ((desc.second.size() > 0)?desc.second + " ":"") << "(" << desc.first << ");"
-		<< std::endl << std::endl;
-
-	keyCommands_.at(ref.name).append(mstr_.str());
-}
-
 } //namespace
 
@@ -5,99 +5,121 @@
 #ifndef SQLFILEPARSER_HPP
 #define SQLFILEPARSER_HPP
 
-#include <ostream>
+#include <set>
+#include <vector>
 
+#include "DiffEmitter.hpp"
+#include "DiffOp.hpp"
 #include "SQLParserHelper.hpp"
 
 namespace sqlfileparser
 {
 
-typedef std::string TableDropCommands;
-typedef std::map<std::string, std::string> TableCommandsMap;
-typedef std::map<std::string, std::string> FieldCommand;
-typedef std::map<std::string, FieldCommand> FieldCommandsMap;
-typedef std::map<std::string, std::string> FieldDropCommandsMap;
-typedef std::map<std::string, std::string> KeyCommandsMap;
+/* how sure we have to be (from 0 to 1) that a dropped column and an added one
+   are the same column renamed; above 1 renames are never looked for
+*/
 
-class SQLFileParser {
+static const double DEFAULT_RENAME_THRESHOLD = 0.5;
 
-	public:
+static const double NO_COLUMN_RENAMES = 2;
 
-		SQLFileParser(const SQLTableListManagerPtr& psm1, const SQLTableListManagerPtr& psm2);
+/* compares the two versions into the list of operations that upgrade the
+   first one to the second; the emitters turn it into text
+*/
 
-		void print(std::ostream& out);
+class SQLFileParser {
 
-	private:
+	public:
 
-		void parseTables();
+/* the tables are compared on up to "threads" threads; the operations come out
+   the same whatever their number. With "tableRenames" a table dropped and one
+   created with about the same columns and keys are taken for the same table
+   renamed (see findRenamedTables())
+*/
 
-		void parseFields(const SQLTable& ref1, const SQLTable& ref2);
+		SQLFileParser(const SQLTableListManagerPtr& psm1, const SQLTableListManagerPtr& psm2, unsigned int threads = 1,
+			double renameThreshold = DEFAULT_RENAME_THRESHOLD, bool tableRenames = false);
 
-		void parsePrimary(const SQLTable& ref1, const SQLTable& ref2);
+/* in the order they have to run: the tables in the order of the second .sql
+   file (a renamed table where the new name is), the dropped tables last
+*/
 
-		void parseForeign(const SQLTable& ref1, const SQLTable& ref2);
+		const DiffOpList& operations() const { return ops_; }
 
-		void parseIndex(const SQLTable& ref1, const SQLTable& ref2);
+/* the operations of each table are formatted on up to "threads" threads too,
+   into parts of the emitter (see DiffEmitter::part()), joined in order
+*/
 
-		void parseUnique(const SQLTable& ref1, const SQLTable& ref2);
+		void print(DiffEmitter& emitter) const;
 
-		void parseFullText(const SQLTable& ref1, const SQLTable& ref2);
+/* streaming: only the first version is held. The tables of the second one are
+   given to streamTable() as they are parsed, which emits their statements at
+   once; finish() then emits the drop table statements for the tables never
+   seen. operations() stays empty.
+*/
 
-		void parseSpatial(const SQLTable& ref1, const SQLTable& ref2);
+		SQLFileParser(const SQLTableListManagerPtr& psm1, double renameThreshold = DEFAULT_RENAME_THRESHOLD);
 
+		void streamTable(const SQLTable& ref2, DiffEmitter& emitter);
 
-/* these are just mysql query printers */
+/* what streamTable() emits, for the caller to emit later; the operations
+   point into ref2
+*/
 
-		void printCreateTableCommand(const SQLTable& ref);
+		void compareTable(const SQLTable& ref2, DiffOpList& ops);
 
-		void printDropTableCommand(const SQLTable& ref);
+		void finish(DiffEmitter& emitter) const;
 
-		void printAlterModifyCommand(const SQLTable& ref, const std::pair<std::string, std::string>& rfield);
+	private:
 
-		void printAlterDropCommand(const SQLTable& ref, const std::string& rfield);
+		struct TableDiff;
 
-		void printAlterAddCommand(const SQLTable& ref, const std::pair<std::string, std::string>& rfield);
+		void parseTables(unsigned int threads, bool tableRenames);
 
-		void printAlterDropPrimaryCommand(const SQLTable& ref);
+		void renameTables(std::vector<DiffOpList>& tableOps, std::set<const SQLTable*>& renamed, unsigned int threads) const;
 
-		void printAlterAddPrimaryCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc);
+		void parseTable(const SQLTable& ref2, DiffOpList& ops) const;
 
-		void printAlterDropForeignCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc);
+		void diffTable(const SQLTable& ref1, const SQLTable& ref2, DiffOpList& ops) const;
 
-		void printAlterAddForeignCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc);
+		void parseFields(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const;
 
-		void printAlterDropIndexCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc);
+		std::vector<std::size_t> findRenamedFields(const SQLTable& ref1, const SQLTable& ref2) const;
 
-		void printAlterAddIndexCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc);
+		std::vector<bool> findMovedFields(const SQLTable& ref1, const SQLTable& ref2, const std::vector<std::size_t>& renamed) const;
 
-		void printAlterDropUniqueCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc);
+		void parsePrimary(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const;
 
-		void printAlterAddUniqueCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc);
+		void parseForeign(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const;
 
-		void printAlterDropFullTextCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc);
+		void parseIndex(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const;
 
-		void printAlterAddFullTextCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc);
+		void parseUnique(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const;
 
-		void printAlterDropSpatialCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc);
+		void parseFullText(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const;
 
-		void printAlterAddSpatialCommand(const SQLTable& ref, const std::pair<std::string, std::string>& desc);
+		void parseSpatial(const SQLTable& ref1, const SQLTable& ref2, TableDiff& diff) const;
 
 
 /* these data structures must be allocated and initialized outside this class;
-   please note that we keep shared pointers to them
+   please note that we keep shared pointers to them (the operations point into
+   their tables)
 */
 
 		const SQLTableListManagerPtr psm1_, psm2_;
 
-		TableCommandsMap tableCommands_;
+		std::shared_ptr<StringPool> pool_;
+
+		const double renameThreshold_;
 
-		TableDropCommands tableDropCommands_;
+		const unsigned int threads_;
 
-		FieldCommandsMap fieldCommands_;
+		DiffOpList ops_;
 
-		FieldDropCommandsMap fieldDropCommands_;
+/* the tables of the first version a streamed table matched
+*/
 
-		KeyCommandsMap keyCommands_;
+		std::set<const SQLTable*> seen_;
 
 };
 
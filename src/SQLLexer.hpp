@@ -0,0 +1,126 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef SQLLEXER_HPP
+#define SQLLEXER_HPP
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#if !defined(yyFlexLexerOnce)
+#include <FlexLexer.h>
+#endif
+
+#include "SQLParserHelper.hpp"
+#include "InputSource.hpp"
+
+namespace sqlfileparser
+{
+
+/* the flex scanner with all of its state kept in members, so any number of
+   files can be parsed at the same time (one SQLLexer per file)
+*/
+
+class SQLLexer : public yyFlexLexer
+{
+	public:
+
+/* a lexer may start in the middle of a file (see ParallelLexParse.cpp): line and
+   offset numbering then start from the given values; warnings go to "log"
+*/
+
+		SQLLexer(InputSource& source, bool skipModifiedTimestamps = false,
+			unsigned long firstLine = 1, std::size_t firstOffset = 0, std::ostream& log = std::cerr);
+
+/* generated by flex from LexParser.l (%option yyclass)
+*/
+
+		int yylex();
+
+/* runs the scanner to the end of the input and hands over the table list
+*/
+
+		SQLTableListManagerPtr parse();
+
+/* false if the input ended inside a "create table" statement
+*/
+
+		bool complete() const { return !inTable_; }
+
+/* the list being filled, to set a table handler on it before parse()
+*/
+
+		SQLTableListManager& tables() { return *psm_; }
+
+	protected:
+
+/* feeds flex; between tables the input is fast-forwarded to the next
+   "create table" so flex never sees the INSERT data
+*/
+
+		virtual int LexerInput(char* buf, int max_size);
+
+	private:
+
+		bool fill();
+
+/* the position of a token (yytext) in the input, for the error messages
+*/
+
+		std::size_t offset(const char* token) const;
+
+		InputSource& source_;
+
+		std::ostream& log_;
+
+		std::string carry_;
+
+		const char* cur_;
+
+		const char* end_;
+
+/* the input offset of the current block, and where the last chunk handed to
+   flex came from and was copied to
+*/
+
+		const char* blockBegin_;
+
+		std::size_t blockOffset_;
+
+		std::size_t chunkOffset_;
+
+		const char* chunkDest_;
+
+/* skipping is only safe when flex has nothing pending but a ";" and the
+   last table has been closed
+*/
+
+		bool inTable_;
+
+		bool atStatementEnd_;
+
+		SQLTableListManagerPtr psm_;
+
+		unsigned long line_;
+
+		int parantLevel_;
+
+		bool wasInt_;
+
+/* the display width skipped after an integer type, and where it was
+*/
+
+		std::string::size_type widthAt_;
+
+		std::string width_;
+
+		bool skipTimestamps_;
+
+		bool lastFieldTimestamp_;
+};
+
+} // namespace
+
+#endif
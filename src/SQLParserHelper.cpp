@@ -10,6 +10,18 @@
 namespace sqlfileparser
 {
 
+static bool
+lessByName(const TableNode& a, const TableNode& b)
+{
+	return a.first < b.first;
+}
+
+static bool
+sameName(const TableNode& a, const TableNode& b)
+{
+	return a.first == b.first;
+}
+
 int
 SQLTable::operator<(const SQLTable& other) const
 {
@@ -19,16 +31,127 @@ SQLTable::operator<(const SQLTable& other) const
 void
 SQLTable::clear()
 {
-	name.clear();
-	tabletype.clear();
+	name = Atom();
+	tabletype = Atom();
 	fields.clear();
 	indexedfields.clear();
+	positions.clear();
 	primary.clear();
 	foreign.clear();
+	noindex.clear();
 	index.clear();
 	unique.clear();
 	fulltext.clear();
 	spatial.clear();
+	fingerprint = Hash128();
+}
+
+void
+SQLTable::freeze()
+{
+/* the definitions come in field order, so their position is their index
+   before sorting
+*/
+
+	std::vector<std::size_t> order(indexedfields.size());
+	for (std::size_t i = 0 ; i < order.size() ; ++i)
+	{
+		order[i] = i;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [this] (std::size_t a, std::size_t b) {
+		return indexedfields[a].first < indexedfields[b].first;
+	});
+
+	TableNodeMap sorted;
+	sorted.reserve(order.size());
+	positions.clear();
+	positions.reserve(order.size());
+
+	for (std::vector<std::size_t>::const_iterator it = order.begin() ; it != order.end() ; ++it)
+	{
+		if (sorted.empty() || !sameName(sorted.back(), indexedfields[*it]))
+		{
+			sorted.push_back(indexedfields[*it]);
+			positions.push_back(*it);
+		}
+	}
+
+	indexedfields.swap(sorted);
+
+	TableIndexList* keys[] = { &primary, &foreign, &noindex, &index, &unique, &fulltext, &spatial };
+	for (std::size_t i = 0 ; i < sizeof(keys) / sizeof(keys[0]) ; ++i)
+	{
+		std::sort(keys[i]->begin(), keys[i]->end());
+	}
+}
+
+const Atom&
+SQLTable::definition(const Atom& field) const
+{
+	TableNodeMap::const_iterator it = std::lower_bound(indexedfields.begin(), indexedfields.end(),
+		TableNode(field, Atom()), lessByName);
+
+	if (it == indexedfields.end() || it->first != field)
+	{
+		throw std::out_of_range("no field " + field);
+	}
+
+	return it->second;
+}
+
+std::size_t
+SQLTable::position(const Atom& field) const
+{
+	TableNodeMap::const_iterator it = std::lower_bound(indexedfields.begin(), indexedfields.end(),
+		TableNode(field, Atom()), lessByName);
+
+	if (it == indexedfields.end() || it->first != field)
+	{
+		return NOPOSITION;
+	}
+
+	return positions[it - indexedfields.begin()];
+}
+
+/* noindex is left out, it only helps building the other lists; the sets are
+   ordered, so the same keys hash the same whatever their order in the dump
+*/
+
+static void
+hashKeys(Hasher128& hasher, const TableIndexList& keys)
+{
+	hasher.number(keys.size());
+
+	for(TableIndexList::const_iterator it = keys.begin(); it != keys.end(); ++it)
+	{
+		hasher.field(it->first.str());
+		hasher.field(it->second.str());
+	}
+}
+
+Hash128
+SQLTable::computeFingerprint() const
+{
+	Hasher128 hasher;
+
+	hasher.field(tabletype.str());
+
+	hasher.number(fields.size());
+	for(TableNodeList::const_iterator fit = fields.begin(); fit != fields.end(); ++fit)
+	{
+		hasher.field(fit->str());
+		hasher.field(definition(*fit).str());
+	}
+
+	hashKeys(hasher, primary);
+	hashKeys(hasher, foreign);
+	hashKeys(hasher, index);
+	hashKeys(hasher, unique);
+	hashKeys(hasher, fulltext);
+	hashKeys(hasher, spatial);
+
+	return hasher.digest();
 }
 
 void
@@ -38,7 +161,7 @@ SQLTable::print(std::ostream& out) const
 
 	for(TableNodeList::const_iterator fit = fields.begin(); fit != fields.end(); ++fit)
 	{
-		out << "FIELD: " << *fit << " " << indexedfields.at(*fit) << std::endl;
+		out << "FIELD: " << *fit << " " << definition(*fit) << std::endl;
 	}
 
 	for(TableIndexList::const_iterator pit = primary.begin(); pit != primary.end(); ++pit)
@@ -75,43 +198,55 @@ SQLTable::print(std::ostream& out) const
 }
 
 SQLTableListManager::SQLTableListManager()
-:tlist_(),
+:pool_(StringPool::shared()),
+tlist_(),
 temptable_(),
 tempfield_(),
 tempconstraint_(),
 tempcontents_(),
 fieldmodifier_(),
-lastState_(DUMMY)
+lastState_(DUMMY),
+handler_()
 {
 }
 
 void
-SQLTableListManager::addNewTable(const std::string& tname)
+SQLTableListManager::addNewTable(std::string_view tname)
 {
 /* cut the ` character from table name
 */
 
-	std::string::size_type first=tname.find_first_not_of('`'), last=tname.find_last_not_of('`');
+	std::string_view::size_type first=tname.find_first_not_of('`'), last=tname.find_last_not_of('`');
 
-	temptable_.name.assign(tname.substr(first, last - first + 1));
+	temptable_.name = pool_->intern(tname.substr(first, last - first + 1));
 }
 
 void
 SQLTableListManager::commitTable()
 {
-	tlist_.insert(temptable_);
-	rawtlist_.push_back(temptable_);
+	temptable_.freeze();
+	temptable_.fingerprint = temptable_.computeFingerprint();
+
+	if (handler_)
+	{
+		handler_(temptable_);
+		temptable_.clear();
+		return;
+	}
+
+	rawtlist_.push_back(std::move(temptable_));
+	tlist_.insert(&rawtlist_.back());
 
 	temptable_.clear();
 }
 
 void
-SQLTableListManager::addNewField(const std::string& tfield)
+SQLTableListManager::addNewField(std::string_view tfield)
 {
 /* remove the ` character from field description (the lexer already does this for name) and go to lowercase
 */
 
-	std::string::size_type first=tfield.find_first_not_of('`'), last=tfield.find_last_not_of('`');
+	std::string_view::size_type first=tfield.find_first_not_of('`'), last=tfield.find_last_not_of('`');
 
 	tempfield_.assign(tfield.substr(first, last - first + 1));
 
@@ -133,7 +268,7 @@ SQLTableListManager::setState(MgrState state)
 void
 SQLTableListManager::addPrimaryKeyFromField()
 {
-	temptable_.primary.insert(std::make_pair<std::string, std::string>("(" + tempfield_ + ")", ""));
+	insertKey(temptable_.primary, "(" + tempfield_ + ")", std::string());
 }
 
 void
@@ -199,7 +334,7 @@ void
 SQLTableListManager::addTableType()
 {
 	std::transform(tempcontents_.begin(), tempcontents_.end(), tempcontents_.begin(), ::tolower);
-	temptable_.tabletype.assign(tempcontents_);
+	temptable_.tabletype = pool_->intern(tempcontents_);
 }
 
 void
@@ -217,8 +352,10 @@ SQLTableListManager::commitField()
 		tempcontents_.append(" null");
 	}
 
-	temptable_.fields.push_back(tempfield_);
-	temptable_.indexedfields.insert(std::make_pair<std::string,std::string>(tempfield_, tempcontents_));
+	const Atom field = pool_->intern(tempfield_);
+
+	temptable_.fields.push_back(field);
+	temptable_.indexedfields.push_back(TableNode(field, pool_->intern(tempcontents_)));
 }
 
 void
@@ -249,18 +386,18 @@ SQLTableListManager::commitPrimary()
 
 	for (std::deque<std::string>::const_iterator it = primaryFields.begin() ; it != primaryFields.end() ; ++it)
 	{
-		std::string cfield(temptable_.indexedfields.at(*it));
+		Atom& cfield(unfrozenDefinition(*it));
 
-		if (cfield.find("not null", 0) == std::string::npos)
+		if (cfield.str().find("not null", 0) == std::string::npos)
 		{
-			std::string::size_type nullpos = cfield.find(" null", 0);
+			std::string::size_type nullpos = cfield.str().find(" null", 0);
 			/* std::string::npos is also ok, we take the whole string */
-			std::string cfieldmod = cfield.substr(0, nullpos) + " not null";
-			temptable_.indexedfields.at(*it).assign(cfieldmod);
+			std::string cfieldmod = cfield.str().substr(0, nullpos) + " not null";
+			cfield = pool_->intern(cfieldmod);
 		}
 	}
 
-	temptable_.primary.insert(std::make_pair<std::string, std::string>(tempcontents_, tempconstraint_));
+	insertKey(temptable_.primary, tempcontents_, tempconstraint_);
 }
 
 void 
@@ -272,23 +409,28 @@ SQLTableListManager::commitForeign()
 	std::string::size_type first=tempcontents_.find_first_of('('), last=tempcontents_.find_first_of(')');
 	std::string indexfield(tempcontents_.substr(first + 1, last - first - 1));
 
-	temptable_.foreign.insert(std::make_pair<std::string, std::string>(tempcontents_, tempconstraint_));
+	insertKey(temptable_.foreign, tempcontents_, tempconstraint_);
 
 /* MySQL dumps contain both the index and the foreign key over the same field;
    We just need the foreign key as the index is created by default (and can't be dropped on its own) */
 
-/* find() does not work in this scenario */
-	TableIndexList::iterator it = temptable_.index.begin(), end_it = temptable_.index.end();
+/* find() does not work in this scenario; if there are several indexes on the
+   field the first one in sorted order goes, as it did when this was a set */
+	TableIndexList::iterator it = temptable_.index.begin(), end_it = temptable_.index.end(), found = end_it;
 	
 	for( ; it != end_it ; ++it)
 	{
-		if (it->first == indexfield)
+		if (it->first.str() == indexfield && (found == end_it || *it < *found))
 		{
-			temptable_.index.erase(it);
-			temptable_.noindex.insert(std::make_pair<std::string, std::string>(indexfield, ""));
-			break;
+			found = it;
 		}
 	}
+
+	if (found != end_it)
+	{
+		temptable_.index.erase(found);
+		insertKey(temptable_.noindex, indexfield, std::string());
+	}
 }
 
 void
@@ -305,10 +447,10 @@ SQLTableListManager::commitIndex()
 
 /* Let's check if we are to add the index as we might have already encountered a foreign key on this field
 */
-	TableIndexList::iterator it = temptable_.noindex.find(std::make_pair<std::string, std::string>(fieldname, ""));
+	TableIndexList::iterator it = std::find(temptable_.noindex.begin(), temptable_.noindex.end(), TableNode(pool_->intern(fieldname), Atom()));
 	if (it == temptable_.noindex.end())
 	{
-		temptable_.index.insert(std::make_pair<std::string, std::string>(fieldname, keyname));
+		insertKey(temptable_.index, fieldname, keyname);
 	}
 }
 
@@ -324,7 +466,7 @@ SQLTableListManager::commitUnique()
 	std::string fieldname(tempcontents_.substr(first + 1, last - first - 1));
 	std::string keyname((space == std::string::npos)?"":tempcontents_.substr(0, space));
 
-	temptable_.unique.insert(std::make_pair<std::string, std::string>(fieldname, keyname));
+	insertKey(temptable_.unique, fieldname, keyname);
 }
 
 void
@@ -339,7 +481,7 @@ SQLTableListManager::commitFulltext()
 	std::string fieldname(tempcontents_.substr(first + 1, last - first - 1));
 	std::string keyname((space == std::string::npos)?"":tempcontents_.substr(0, space));
 
-	temptable_.fulltext.insert(std::make_pair<std::string, std::string>(fieldname, keyname));
+	insertKey(temptable_.fulltext, fieldname, keyname);
 }
 
 void
@@ -354,7 +496,37 @@ SQLTableListManager::commitSpatial()
 	std::string fieldname(tempcontents_.substr(first + 1, last - first - 1));
 	std::string keyname((space == std::string::npos)?"":tempcontents_.substr(0, space));
 
-	temptable_.spatial.insert(std::make_pair<std::string, std::string>(fieldname, keyname));
+	insertKey(temptable_.spatial, fieldname, keyname);
+}
+
+/* while a table is being built its lists are unsorted and short: keys are
+   inserted like into a set, fields are looked up like in a map (the first
+   definition wins)
+*/
+
+void
+SQLTableListManager::insertKey(TableIndexList& keys, const std::string& first, const std::string& second)
+{
+	const TableNode key(pool_->intern(first), pool_->intern(second));
+
+	if (std::find(keys.begin(), keys.end(), key) == keys.end())
+	{
+		keys.push_back(key);
+	}
+}
+
+Atom&
+SQLTableListManager::unfrozenDefinition(const std::string& field)
+{
+	for (TableNodeMap::iterator it = temptable_.indexedfields.begin() ; it != temptable_.indexedfields.end() ; ++it)
+	{
+		if (it->first.str() == field)
+		{
+			return it->second;
+		}
+	}
+
+	throw std::out_of_range("no field " + field);
 }
 
 void
@@ -370,13 +542,34 @@ SQLTableListManager::clear()
 	lastState_ = DUMMY;
 }
 
+void
+SQLTableListManager::append(SQLTableListManager& other)
+{
+	for(SQLTableRawList::iterator it = other.rawtlist_.begin() ; it != other.rawtlist_.end() ; ++it)
+	{
+		rawtlist_.push_back(std::move(*it));
+		tlist_.insert(&rawtlist_.back());
+	}
+
+	other.clear();
+}
+
+void
+SQLTableListManager::addTable(SQLTable& table)
+{
+	rawtlist_.push_back(std::move(table));
+	tlist_.insert(&rawtlist_.back());
+
+	table.clear();
+}
+
 void
 SQLTableListManager::print(std::ostream& out) const
 {
 	out << "---------------------------------" << std::endl;
 	for(SQLTableList::const_iterator it = tlist_.begin() ; it != tlist_.end() ; ++it)
 	{
-		it->print(out);
+		(*it)->print(out);
 		out << "---------------------------------" << std::endl;
 	}
 }
@@ -7,36 +7,59 @@
 
 #include <set>
 #include <deque>
-#include <map>
+#include <vector>
 #include <string>
+#include <string_view>
 #include <ostream>
 #include <memory>
+#include <functional>
+
+#include "Hash.hpp"
+#include "StringPool.hpp"
 
 namespace sqlfileparser
 {
 
-typedef std::deque<std::string> TableNodeList;
-typedef std::map<std::string, std::string> TableNodeMap;
-typedef std::set<std::pair<std::string, std::string> > TableIndexList;
+/* flat arrays rather than node based containers: a table is built once and
+   then only walked through, in order, by the diff; the strings are interned
+   so comparing two of them for equality is comparing two pointers
+*/
+
+typedef std::pair<Atom, Atom> TableNode;
+typedef std::vector<Atom> TableNodeList;
+typedef std::vector<TableNode> TableNodeMap;
+typedef std::vector<TableNode> TableIndexList;
 
 struct SQLTable {
 
-	std::string name, tabletype;
+	Atom name, tabletype;
 
 /* the fields are kept into 2 data structures; the first one is indexed
-   for the use of the algorythm while the second is used for the output
-   ordering
+   (sorted by field name once the table is frozen) for the use of the
+   algorythm while the second is used for the output ordering
 */
 	TableNodeList fields;
 
 	TableNodeMap indexedfields;
 
+/* positions[i] is where indexedfields[i] sits in "fields"
+*/
+
+	std::vector<std::size_t> positions;
+
 /* the order isn't relevant for constraints / keys / indexes so any
-   output order will do
+   output order will do; they hold no duplicates and get sorted when the
+   table is frozen
 */
 
 	TableIndexList primary, foreign, noindex, index, unique, fulltext, spatial;
 
+/* a hash of everything above but the name, set when the table is committed:
+   two tables with the same fingerprint can't produce any alter statement
+*/
+
+	Hash128 fingerprint;
+
 /* we can't put the struct into an indexed container without providing
    a comparison operator
 */
@@ -45,11 +68,47 @@ struct SQLTable {
 
 	void clear();
 
+/* sorts the indexed lists once the table is complete; for a field defined
+   twice the first definition is kept
+*/
+
+	void freeze();
+
+/* the definition of a field of a frozen table; throws std::out_of_range if
+   there is no such field
+*/
+
+	const Atom& definition(const Atom& field) const;
+
+/* the index of a field in "fields" (its first occurrence), NOPOSITION if
+   there is no such field; also for frozen tables only
+*/
+
+	static const std::size_t NOPOSITION = static_cast<std::size_t>(-1);
+
+	std::size_t position(const Atom& field) const;
+
+	Hash128 computeFingerprint() const;
+
 	void print(std::ostream&) const;
 };
 
+/* the tables are owned by the list in file order (a deque never moves what it
+   holds); the list in name order only points to them
+*/
+
+struct SQLTableNameLess {
+
+	bool operator()(const SQLTable* a, const SQLTable* b) const { return *a < *b; }
+};
+
 typedef std::deque<SQLTable> SQLTableRawList;
-typedef std::set<SQLTable> SQLTableList;
+typedef std::set<const SQLTable*, SQLTableNameLess> SQLTableList;
+
+/* gets every table as soon as it is committed, frozen and fingerprinted
+*/
+
+typedef std::function<void(SQLTable&)> SQLTableHandler;
 
 enum MgrState {
 	DUMMY = 0,
@@ -68,11 +127,11 @@ class SQLTableListManager
 
 		SQLTableListManager();
 
-		void addNewTable(const std::string& tname);
+		void addNewTable(std::string_view tname);
 
 		void commitTable();
 
-		void addNewField(const std::string& tfield);
+		void addNewField(std::string_view tfield);
 
 		void setState(MgrState state);
 		
@@ -88,6 +147,24 @@ class SQLTableListManager
 
 		void clear();
 
+/* moves the tables of "other" after ours, as if they had been read from the
+   same file after the last one of ours
+*/
+
+		void append(SQLTableListManager& other);
+
+/* adds a table built elsewhere (a snapshot...) the way commitTable() adds the
+   one being parsed; "table" has to be frozen and is left empty
+*/
+
+		void addTable(SQLTable& table);
+
+/* from now on the committed tables go to "handler" and are dropped afterwards
+   instead of being kept in the lists
+*/
+
+		void setTableHandler(const SQLTableHandler& handler) { handler_ = handler; }
+
 		void print(std::ostream& out) const;
 
 /* the "good practice" says that we should export private members
@@ -98,7 +175,7 @@ class SQLTableListManager
 
 		const SQLTableRawList& rawtlist() const { return rawtlist_; }
 
-		const std::string& tempTable() const { return temptable_.name; }
+		const std::string& tempTable() const { return temptable_.name.str(); }
 
 		std::string& tempConstraint() { return tempconstraint_; }
 		
@@ -108,6 +185,13 @@ class SQLTableListManager
 
 	private:
 
+/* tlist_ points into rawtlist_, a copy would point into the original
+*/
+
+		SQLTableListManager(const SQLTableListManager&);
+
+		SQLTableListManager& operator=(const SQLTableListManager&);
+
 		void commitField();
 
 		void commitPrimary();
@@ -122,6 +206,12 @@ class SQLTableListManager
 
 		void commitSpatial();
 
+		void insertKey(TableIndexList& keys, const std::string& first, const std::string& second);
+
+		Atom& unfrozenDefinition(const std::string& field);
+
+		std::shared_ptr<StringPool> pool_;
+
 		SQLTableList tlist_;
 
 		SQLTableRawList rawtlist_;
@@ -137,6 +227,8 @@ class SQLTableListManager
 		std::string fieldmodifier_;
 
 		MgrState lastState_;
+
+		SQLTableHandler handler_;
 };
 
 typedef std::shared_ptr<SQLTableListManager> SQLTableListManagerPtr;
@@ -0,0 +1,320 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+
+#include "Similarity.hpp"
+#include "Hash.hpp"
+#include "Parallel.hpp"
+
+namespace sqlfileparser
+{
+
+namespace
+{
+
+/* 16 bands of 4 minimums: two tables with 70% of their columns and keys in
+   common share a band with a probability of about 99%, with 50% of about 64%,
+   with 30% of about 12%
+*/
+
+const std::size_t SIGNATURE_BANDS = 16;
+
+const std::size_t BAND_ROWS = 4;
+
+const std::size_t SIGNATURE_SIZE = SIGNATURE_BANDS * BAND_ROWS;
+
+/* a table with fewer columns and keys than this looks like too many others
+   (an id and a name) to be told apart by them
+*/
+
+const std::size_t MIN_FEATURES = 3;
+
+/* a bucket holding more dropped tables than this is a band common to a whole
+   family of tables; it would bring back the comparison of everything with
+   everything, so it is ignored (the other bands still count)
+*/
+
+const std::size_t BUCKET_LIMIT = 256;
+
+struct TableSignature {
+
+	TableSignature()
+	:features(),
+	bands()
+	{
+	}
+
+/* the hashes of the columns and keys, sorted, without duplicates
+*/
+
+	std::vector<std::uint64_t> features;
+
+/* one bucket key per band, empty for the tables left out
+*/
+
+	std::vector<std::uint64_t> bands;
+};
+
+struct RenameCandidate {
+
+	double similarity, nameSimilarity;
+
+	std::size_t dropped, created;
+
+	bool operator<(const RenameCandidate& other) const
+	{
+		if (similarity != other.similarity)
+		{
+			return similarity > other.similarity;
+		}
+		if (nameSimilarity != other.nameSimilarity)
+		{
+			return nameSimilarity > other.nameSimilarity;
+		}
+		return (dropped != other.dropped) ? dropped < other.dropped : created < other.created;
+	}
+};
+
+/* the splitmix64 finalizer: the MinHash functions are mix(feature ^ seed)
+*/
+
+std::uint64_t
+mix(std::uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+std::uint64_t
+feature(const char* kind, const Atom& a, const Atom& b)
+{
+	Hasher128 hasher;
+	hasher.field(kind);
+	hasher.field(a.str());
+	hasher.field(b.str());
+	return hasher.digest().lo;
+}
+
+/* the columns with their definitions and the keys with their columns; the
+   names of the keys are left out, they often carry the name of the table
+*/
+
+std::vector<std::uint64_t>
+tableFeatures(const SQLTable& table)
+{
+	std::vector<std::uint64_t> features;
+
+	for (TableNodeMap::const_iterator it = table.indexedfields.begin() ; it != table.indexedfields.end() ; ++it)
+	{
+		features.push_back(feature("column", it->first, it->second));
+	}
+
+	const std::pair<const char*, const TableIndexList*> keys[] = {
+		std::make_pair("primary", &table.primary),
+		std::make_pair("foreign", &table.foreign),
+		std::make_pair("index", &table.index),
+		std::make_pair("unique", &table.unique),
+		std::make_pair("fulltext", &table.fulltext),
+		std::make_pair("spatial", &table.spatial)
+	};
+
+	for (std::size_t k = 0 ; k < sizeof(keys) / sizeof(keys[0]) ; ++k)
+	{
+		for (TableIndexList::const_iterator it = keys[k].second->begin() ; it != keys[k].second->end() ; ++it)
+		{
+			features.push_back(feature(keys[k].first, it->first, Atom()));
+		}
+	}
+
+	std::sort(features.begin(), features.end());
+	features.erase(std::unique(features.begin(), features.end()), features.end());
+
+	return features;
+}
+
+/* the MinHash signature cut into bands, each band hashed into one key (the
+   band number goes in as well, so all the bands can share one bucket map)
+*/
+
+std::vector<std::uint64_t>
+bandKeys(const std::vector<std::uint64_t>& features)
+{
+	std::vector<std::uint64_t> signature(SIGNATURE_SIZE, ~static_cast<std::uint64_t>(0));
+
+	for (std::size_t k = 0 ; k < SIGNATURE_SIZE ; ++k)
+	{
+		const std::uint64_t seed = mix(0x9e3779b97f4a7c15ULL * (k + 1));
+		for (std::vector<std::uint64_t>::const_iterator it = features.begin() ; it != features.end() ; ++it)
+		{
+			signature[k] = std::min(signature[k], mix(*it ^ seed));
+		}
+	}
+
+	std::vector<std::uint64_t> bands(SIGNATURE_BANDS);
+	for (std::size_t b = 0 ; b < SIGNATURE_BANDS ; ++b)
+	{
+		std::uint64_t key = mix(b + 1);
+		for (std::size_t r = 0 ; r < BAND_ROWS ; ++r)
+		{
+			key = mix(key ^ signature[b * BAND_ROWS + r]);
+		}
+		bands[b] = key;
+	}
+
+	return bands;
+}
+
+double
+jaccard(const std::vector<std::uint64_t>& a, const std::vector<std::uint64_t>& b)
+{
+	std::size_t common = 0;
+
+	for (std::size_t i = 0, j = 0 ; i < a.size() && j < b.size() ; )
+	{
+		if (a[i] < b[j])
+		{
+			++i;
+		}
+		else if (b[j] < a[i])
+		{
+			++j;
+		}
+		else
+		{
+			++common;
+			++i;
+			++j;
+		}
+	}
+
+	return static_cast<double>(common) / (a.size() + b.size() - common);
+}
+
+} // anonymous namespace
+
+double
+nameSimilarity(const std::string& a, const std::string& b)
+{
+	if (a.empty() && b.empty())
+	{
+		return 1;
+	}
+
+	std::vector<std::size_t> row(b.size() + 1);
+	for (std::size_t j = 0 ; j <= b.size() ; ++j)
+	{
+		row[j] = j;
+	}
+
+	for (std::size_t i = 1 ; i <= a.size() ; ++i)
+	{
+		std::size_t diagonal = row[0];
+		row[0] = i;
+
+		for (std::size_t j = 1 ; j <= b.size() ; ++j)
+		{
+			const std::size_t above = row[j];
+			row[j] = std::min(std::min(row[j] + 1, row[j - 1] + 1), diagonal + ((a[i - 1] == b[j - 1]) ? 0 : 1));
+			diagonal = above;
+		}
+	}
+
+	return 1 - static_cast<double>(row[b.size()]) / std::max(a.size(), b.size());
+}
+
+std::vector<std::pair<std::size_t, std::size_t> >
+findRenamedTables(const std::vector<const SQLTable*>& dropped, const std::vector<const SQLTable*>& created, unsigned int threads)
+{
+
+/* the dropped tables first, then the created ones
+*/
+
+	std::vector<TableSignature> signatures(dropped.size() + created.size());
+
+	parallelFor(signatures.size(), threads, [&] (std::size_t i) {
+		const SQLTable& table = (i < dropped.size()) ? *dropped[i] : *created[i - dropped.size()];
+
+		signatures[i].features = tableFeatures(table);
+		if (signatures[i].features.size() >= MIN_FEATURES)
+		{
+			signatures[i].bands = bandKeys(signatures[i].features);
+		}
+	});
+
+	std::unordered_map<std::uint64_t, std::vector<std::size_t> > buckets;
+
+	for (std::size_t d = 0 ; d < dropped.size() ; ++d)
+	{
+		for (std::vector<std::uint64_t>::const_iterator it = signatures[d].bands.begin() ; it != signatures[d].bands.end() ; ++it)
+		{
+			buckets[*it].push_back(d);
+		}
+	}
+
+/* every created table against the dropped ones sharing a bucket with it
+*/
+
+	std::vector<std::vector<RenameCandidate> > found(created.size());
+
+	parallelFor(created.size(), threads, [&] (std::size_t c) {
+		const TableSignature& signature = signatures[dropped.size() + c];
+		std::vector<std::size_t> neighbours;
+
+		for (std::vector<std::uint64_t>::const_iterator it = signature.bands.begin() ; it != signature.bands.end() ; ++it)
+		{
+			std::unordered_map<std::uint64_t, std::vector<std::size_t> >::const_iterator bucket = buckets.find(*it);
+			if (bucket != buckets.end() && bucket->second.size() <= BUCKET_LIMIT)
+			{
+				neighbours.insert(neighbours.end(), bucket->second.begin(), bucket->second.end());
+			}
+		}
+
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+		for (std::vector<std::size_t>::const_iterator d = neighbours.begin() ; d != neighbours.end() ; ++d)
+		{
+			const double similarity = jaccard(signatures[*d].features, signature.features);
+			if (similarity >= TABLE_RENAME_SIMILARITY)
+			{
+				RenameCandidate candidate = { similarity, nameSimilarity(dropped[*d]->name.str(), created[c]->name.str()), *d, c };
+				found[c].push_back(candidate);
+			}
+		}
+	});
+
+	std::vector<RenameCandidate> candidates;
+	for (std::vector<std::vector<RenameCandidate> >::const_iterator it = found.begin() ; it != found.end() ; ++it)
+	{
+		candidates.insert(candidates.end(), it->begin(), it->end());
+	}
+
+/* the most similar first; on a tie the closest names, then the file order
+*/
+
+	std::sort(candidates.begin(), candidates.end());
+
+	std::vector<bool> droppedTaken(dropped.size(), false), createdTaken(created.size(), false);
+	std::vector<std::pair<std::size_t, std::size_t> > renames;
+
+	for (std::vector<RenameCandidate>::const_iterator it = candidates.begin() ; it != candidates.end() ; ++it)
+	{
+		if (!droppedTaken[it->dropped] && !createdTaken[it->created])
+		{
+			droppedTaken[it->dropped] = createdTaken[it->created] = true;
+			renames.push_back(std::make_pair(it->dropped, it->created));
+		}
+	}
+
+	return renames;
+}
+
+} //namespace
@@ -0,0 +1,45 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef SIMILARITY_HPP
+#define SIMILARITY_HPP
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "SQLParserHelper.hpp"
+
+namespace sqlfileparser
+{
+
+/* 1 for the same name, down to 0 for names with nothing in common (the edit
+   distance against the longest of them)
+*/
+
+	double nameSimilarity(const std::string& a, const std::string& b);
+
+/* how much of their columns and keys (from 0 to 1) a dropped table and a
+   created one must have in common to be taken for the same table renamed
+*/
+
+static const double TABLE_RENAME_SIMILARITY = 0.7;
+
+/* the tables of "dropped" that were most probably renamed into tables of
+   "created", as pairs of (index in dropped, index in created); each table is
+   in one pair at most, the most similar pairs are taken first.
+   A table is seen as the set of its columns (name and definition) and keys;
+   tables with a MinHash signature in common in any of the LSH bands are the
+   only ones ever compared, so this stays about linear in the number of
+   tables. The candidates are then checked on the exact Jaccard similarity of
+   their sets. The signatures are computed on up to "threads" threads.
+*/
+
+	std::vector<std::pair<std::size_t, std::size_t> > findRenamedTables(const std::vector<const SQLTable*>& dropped,
+		const std::vector<const SQLTable*>& created, unsigned int threads);
+
+} // namespace
+
+#endif
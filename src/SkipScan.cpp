@@ -0,0 +1,154 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "SkipScan.hpp"
+
+namespace sqlfileparser
+{
+
+namespace
+{
+
+enum MatchResult {
+	NOMATCH = 0,
+	MATCH,
+	PARTIAL
+};
+
+/* the same thing the (?i:create{sep}table) rule of the lexer accepts;
+   or-ing with 0x20 folds the case of letters and of nothing else we compare with
+*/
+
+MatchResult
+matchCreateTable(const char* p, const char* end)
+{
+	static const char create[] = "create";
+	static const char table[] = "table";
+
+	for (int i = 0; i < 6; ++i, ++p)
+	{
+		if (p == end) return PARTIAL;
+		if ((*p | 0x20) != create[i]) return NOMATCH;
+	}
+
+	if (p == end) return PARTIAL;
+	if (*p != ' ' && *p != '\t') return NOMATCH;
+
+	while (p != end && (*p == ' ' || *p == '\t')) ++p;
+
+	for (int i = 0; i < 5; ++i, ++p)
+	{
+		if (p == end) return PARTIAL;
+		if ((*p | 0x20) != table[i]) return NOMATCH;
+	}
+
+	return MATCH;
+}
+
+} // anonymous namespace
+
+const char*
+findCreateTable(const char* begin, const char* end, unsigned long& lines, bool& partial)
+{
+	const char* p = begin;
+	unsigned long newlines = 0;
+
+	partial = false;
+
+/* the vector loops only stop on a "cr" pair (any case), counting the newlines
+   of every block they jump over; the candidates are verified one by one
+*/
+
+#if defined(__AVX2__)
+
+	const __m256i lowc = _mm256_set1_epi8('c'), lowr = _mm256_set1_epi8('r');
+	const __m256i fold = _mm256_set1_epi8(0x20), nl = _mm256_set1_epi8('\n');
+
+	for ( ; end - p > 32 ; p += 32)
+	{
+		__m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+
+		unsigned int cand = _mm256_movemask_epi8(_mm256_and_si256(
+			_mm256_cmpeq_epi8(_mm256_or_si256(cur, fold), lowc),
+			_mm256_cmpeq_epi8(_mm256_or_si256(next, fold), lowr)));
+		unsigned int nls = _mm256_movemask_epi8(_mm256_cmpeq_epi8(cur, nl));
+
+		for ( ; cand != 0 ; cand &= cand - 1)
+		{
+			int i = __builtin_ctz(cand);
+			MatchResult res = matchCreateTable(p + i, end);
+			if (res != NOMATCH)
+			{
+				lines += newlines + __builtin_popcount(nls & ((1u << i) - 1));
+				partial = (res == PARTIAL);
+				return p + i;
+			}
+		}
+
+		newlines += __builtin_popcount(nls);
+	}
+
+#elif defined(__SSE2__)
+
+	const __m128i lowc = _mm_set1_epi8('c'), lowr = _mm_set1_epi8('r');
+	const __m128i fold = _mm_set1_epi8(0x20), nl = _mm_set1_epi8('\n');
+
+	for ( ; end - p > 16 ; p += 16)
+	{
+		__m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+
+		unsigned int cand = _mm_movemask_epi8(_mm_and_si128(
+			_mm_cmpeq_epi8(_mm_or_si128(cur, fold), lowc),
+			_mm_cmpeq_epi8(_mm_or_si128(next, fold), lowr)));
+		unsigned int nls = _mm_movemask_epi8(_mm_cmpeq_epi8(cur, nl));
+
+		for ( ; cand != 0 ; cand &= cand - 1)
+		{
+			int i = __builtin_ctz(cand);
+			MatchResult res = matchCreateTable(p + i, end);
+			if (res != NOMATCH)
+			{
+				lines += newlines + __builtin_popcount(nls & ((1u << i) - 1));
+				partial = (res == PARTIAL);
+				return p + i;
+			}
+		}
+
+		newlines += __builtin_popcount(nls);
+	}
+
+#endif
+
+/* the tail (or everything, without SSE2)
+*/
+
+	for ( ; p != end ; ++p)
+	{
+		if (*p == '\n')
+		{
+			newlines++;
+		}
+		else if ((*p | 0x20) == 'c')
+		{
+			MatchResult res = matchCreateTable(p, end);
+			if (res != NOMATCH)
+			{
+				partial = (res == PARTIAL);
+				break;
+			}
+		}
+	}
+
+	lines += newlines;
+
+	return p;
+}
+
+} //namespace
@@ -0,0 +1,23 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef SKIPSCAN_HPP
+#define SKIPSCAN_HPP
+
+namespace sqlfileparser
+{
+
+/* looks for the next case insensitive "create<blanks>table" in [begin, end)
+   and returns where it starts; newlines found before that position are added
+   to "lines".
+   If the range ends in the middle of a possible match, the start of that match
+   is returned and "partial" is set: the caller has to append more input and
+   look again from there. If there is nothing to find, end is returned.
+*/
+
+	const char* findCreateTable(const char* begin, const char* end, unsigned long& lines, bool& partial);
+
+} // namespace
+
+#endif
@@ -0,0 +1,328 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "configure.h"
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "Snapshot.hpp"
+#include "Hash.hpp"
+#include "InputSource.hpp"
+#include "LexParser.hpp"
+
+namespace sqlfileparser
+{
+
+namespace
+{
+
+const char MAGIC[8] = { 'S', 'Q', 'L', 'D', 'S', 'N', 'A', 'P' };
+
+class SnapshotWriter
+{
+	public:
+
+		void number(std::uint64_t value)
+		{
+			for (int i = 0 ; i < 8 ; ++i, value >>= 8)
+			{
+				buffer_ += static_cast<char>(value & 0xff);
+			}
+		}
+
+		void string(const std::string& str)
+		{
+			number(str.size());
+			buffer_ += str;
+		}
+
+		void hash(const Hash128& hash)
+		{
+			number(hash.lo);
+			number(hash.hi);
+		}
+
+		void keys(const TableIndexList& keys)
+		{
+			number(keys.size());
+			for (TableIndexList::const_iterator it = keys.begin() ; it != keys.end() ; ++it)
+			{
+				string(it->first);
+				string(it->second);
+			}
+		}
+
+		std::string& buffer() { return buffer_; }
+
+	private:
+
+		std::string buffer_;
+};
+
+class SnapshotReader
+{
+	public:
+
+		SnapshotReader(const char* begin, const char* end) : cur_(begin), end_(end), pool_(StringPool::shared()) {}
+
+		std::uint64_t number()
+		{
+			need(8);
+
+			std::uint64_t value = 0;
+			for (int i = 7 ; i >= 0 ; --i)
+			{
+				value = (value << 8) | static_cast<unsigned char>(cur_[i]);
+			}
+			cur_ += 8;
+
+			return value;
+		}
+
+		std::string string()
+		{
+			std::uint64_t len = number();
+			need(len);
+
+			std::string str(cur_, len);
+			cur_ += len;
+
+			return str;
+		}
+
+		Hash128 hash()
+		{
+			Hash128 hash;
+			hash.lo = number();
+			hash.hi = number();
+
+			return hash;
+		}
+
+		Atom atom()
+		{
+			std::uint64_t len = number();
+			need(len);
+
+			Atom atom = pool_->intern(std::string_view(cur_, len));
+			cur_ += len;
+
+			return atom;
+		}
+
+		void keys(TableIndexList& keys)
+		{
+			for (std::uint64_t n = number() ; n > 0 ; --n)
+			{
+				Atom first(atom());
+				keys.push_back(TableNode(first, atom()));
+			}
+		}
+
+		bool atEnd() const { return cur_ == end_; }
+
+	private:
+
+		void need(std::uint64_t len)
+		{
+			if (static_cast<std::uint64_t>(end_ - cur_) < len)
+			{
+				throw std::runtime_error("truncated snapshot");
+			}
+		}
+
+		const char* cur_;
+
+		const char* end_;
+
+		std::shared_ptr<StringPool> pool_;
+};
+
+/* everything that changes the parse result goes into the name
+*/
+
+std::string
+snapshotName(const std::string& fname, bool skipModifiedTimestamps)
+{
+	Hasher128 hasher;
+
+	const Hash128 contents = hashFile(fname);
+
+	hasher.number(contents.lo);
+	hasher.number(contents.hi);
+	hasher.number(SNAPSHOT_FORMAT);
+#ifdef VERSION
+	hasher.field(VERSION);
+#endif
+	hasher.number(skipModifiedTimestamps ? 1 : 0);
+
+	return hasher.digest().hex() + ".snap";
+}
+
+} // anonymous namespace
+
+void
+saveSnapshot(const SQLTableListManager& psm, const std::string& fname)
+{
+	SnapshotWriter writer;
+
+	writer.buffer().append(MAGIC, sizeof(MAGIC));
+	writer.number(SNAPSHOT_FORMAT);
+	writer.number(psm.rawtlist().size());
+
+	for (SQLTableRawList::const_iterator it = psm.rawtlist().begin() ; it != psm.rawtlist().end() ; ++it)
+	{
+		writer.string(it->name);
+		writer.string(it->tabletype);
+		writer.hash(it->fingerprint);
+
+		writer.number(it->fields.size());
+		for (TableNodeList::const_iterator fit = it->fields.begin() ; fit != it->fields.end() ; ++fit)
+		{
+			writer.string(*fit);
+			writer.string(it->definition(*fit));
+		}
+
+		writer.keys(it->primary);
+		writer.keys(it->foreign);
+		writer.keys(it->noindex);
+		writer.keys(it->index);
+		writer.keys(it->unique);
+		writer.keys(it->fulltext);
+		writer.keys(it->spatial);
+	}
+
+	Hasher128 hasher;
+	hasher.update(writer.buffer());
+	writer.hash(hasher.digest());
+
+/* written aside and renamed, so a concurrent run never maps half a snapshot
+*/
+
+	const std::string tmpname(fname + ".tmp" + std::to_string(::getpid()));
+
+	std::ofstream out(tmpname.c_str(), std::ios::binary);
+	out.write(writer.buffer().data(), writer.buffer().size());
+	out.close();
+
+	if (!out.good() || std::rename(tmpname.c_str(), fname.c_str()) != 0)
+	{
+		std::remove(tmpname.c_str());
+		throw std::runtime_error("cannot write snapshot " + fname + ".");
+	}
+}
+
+SQLTableListManagerPtr
+loadSnapshot(const std::string& fname)
+{
+	MappedInputSource source(fname);
+
+	if (source.size() < sizeof(MAGIC) + 16 || std::memcmp(source.data(), MAGIC, sizeof(MAGIC)) != 0)
+	{
+		throw std::runtime_error("not a snapshot: " + fname);
+	}
+
+	const char* payloadEnd = source.data() + source.size() - 16;
+
+	Hasher128 hasher;
+	hasher.update(source.data(), payloadEnd - source.data());
+	if (SnapshotReader(payloadEnd, payloadEnd + 16).hash() != hasher.digest())
+	{
+		throw std::runtime_error("damaged snapshot: " + fname);
+	}
+
+	SnapshotReader reader(source.data() + sizeof(MAGIC), payloadEnd);
+
+	if (reader.number() != SNAPSHOT_FORMAT)
+	{
+		throw std::runtime_error("snapshot of another format: " + fname);
+	}
+
+	SQLTableListManagerPtr psm(new SQLTableListManager);
+	SQLTable table;
+
+	for (std::uint64_t n = reader.number() ; n > 0 ; --n)
+	{
+		table.name = reader.atom();
+		table.tabletype = reader.atom();
+		table.fingerprint = reader.hash();
+
+		for (std::uint64_t f = reader.number() ; f > 0 ; --f)
+		{
+			Atom field(reader.atom());
+			table.indexedfields.push_back(TableNode(field, reader.atom()));
+			table.fields.push_back(field);
+		}
+
+		reader.keys(table.primary);
+		reader.keys(table.foreign);
+		reader.keys(table.noindex);
+		reader.keys(table.index);
+		reader.keys(table.unique);
+		reader.keys(table.fulltext);
+		reader.keys(table.spatial);
+
+		table.freeze();
+		psm->addTable(table);
+	}
+
+	if (!reader.atEnd())
+	{
+		throw std::runtime_error("damaged snapshot: " + fname);
+	}
+
+	return psm;
+}
+
+SQLTableListManagerPtr
+lexParseCached(const std::string& fname, bool skipModifiedTimestamps, unsigned int threads,
+	const std::string& cacheDir, std::ostream& log)
+{
+	if (cacheDir.empty() || fname == "-" || !MappedInputSource::canMap(fname))
+	{
+		return lexParse(fname, skipModifiedTimestamps, threads, log);
+	}
+
+	const std::string snapshot((std::filesystem::path(cacheDir) / snapshotName(fname, skipModifiedTimestamps)).string());
+
+	if (MappedInputSource::canMap(snapshot))
+	{
+		try
+		{
+			return loadSnapshot(snapshot);
+		}
+		catch(std::exception& ex)
+		{
+			log << "WARNING: " << ex.what() << ", parsing " << fname << " again" << std::endl;
+		}
+	}
+
+	SQLTableListManagerPtr psm = lexParse(fname, skipModifiedTimestamps, threads, log);
+
+/* a cache we can't write to only costs time
+*/
+
+	try
+	{
+		std::filesystem::create_directories(cacheDir);
+		saveSnapshot(*psm, snapshot);
+	}
+	catch(std::exception& ex)
+	{
+		log << "WARNING: " << ex.what() << std::endl;
+	}
+
+	return psm;
+}
+
+} //namespace
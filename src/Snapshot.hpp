@@ -0,0 +1,45 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <ostream>
+#include <string>
+
+#include "SQLParserHelper.hpp"
+
+namespace sqlfileparser
+{
+
+/* a parsed table list written to disk: the tables in file order (the indexed
+   list is rebuilt from them on load, the same way the lexer built it), every
+   number little endian, the whole thing followed by its own hash.
+   Bump the format number whenever the layout or the lexer output changes, old
+   snapshots are then ignored.
+*/
+
+	static const unsigned int SNAPSHOT_FORMAT = 1;
+
+	void saveSnapshot(const SQLTableListManager& psm, const std::string& fname);
+
+/* maps the file and reads it back; throws if it is truncated, damaged or of
+   another format
+*/
+
+	SQLTableListManagerPtr loadSnapshot(const std::string& fname);
+
+/* lexParse() with a cache: regular files (compressed or not) are hashed and a
+   snapshot named after the hash, the parser version and the options is looked
+   for in "cacheDir"; if there is none the file is parsed and the snapshot
+   written for the next run. Warnings are only printed when the file is parsed.
+   Directories, stdin and an empty "cacheDir" simply go to lexParse().
+*/
+
+	SQLTableListManagerPtr lexParseCached(const std::string& fname, bool skipModifiedTimestamps, unsigned int threads,
+		const std::string& cacheDir, std::ostream& log);
+
+} // namespace
+
+#endif
@@ -0,0 +1,94 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <functional>
+
+#include "StringPool.hpp"
+
+namespace sqlfileparser
+{
+
+/* the empty string is the same for every pool, so a default constructed
+   Atom equals an interned ""
+*/
+
+static const std::string&
+emptyString()
+{
+	static const std::string empty;
+
+	return empty;
+}
+
+Atom::Atom()
+:str_(&emptyString())
+{
+}
+
+std::string
+operator+(const Atom& a, const char* b)
+{
+	return a.str() + b;
+}
+
+std::string
+operator+(const char* a, const Atom& b)
+{
+	return a + b.str();
+}
+
+std::ostream&
+operator<<(std::ostream& out, const Atom& atom)
+{
+	return out << atom.str();
+}
+
+Atom
+StringPool::intern(std::string_view str)
+{
+	if (str.empty())
+	{
+		return Atom();
+	}
+
+	const std::size_t hash = std::hash<std::string_view>()(str);
+	Shard& shard = shards_[hash % SHARDS];
+
+	std::lock_guard<std::mutex> guard(shard.lock);
+
+	std::unordered_map<std::string_view, const std::string*>::const_iterator it = shard.index.find(str);
+	if (it != shard.index.end())
+	{
+		return Atom(it->second);
+	}
+
+/* a deque never moves its elements, the keys of the index point into them
+*/
+
+	shard.strings.push_back(std::string(str));
+	const std::string* stored = &shard.strings.back();
+	shard.index.insert(std::make_pair(std::string_view(*stored), stored));
+
+	return Atom(stored);
+}
+
+std::shared_ptr<StringPool>
+StringPool::shared()
+{
+	static std::mutex lock;
+	static std::weak_ptr<StringPool> current;
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	std::shared_ptr<StringPool> pool(current.lock());
+	if (!pool)
+	{
+		pool.reset(new StringPool);
+		current = pool;
+	}
+
+	return pool;
+}
+
+} //namespace
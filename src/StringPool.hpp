@@ -0,0 +1,100 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef STRINGPOOL_HPP
+#define STRINGPOOL_HPP
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace sqlfileparser
+{
+
+/* a string stored once in a StringPool; copying one copies a pointer.
+   Atoms of the same pool are equal when they point to the same string, so
+   == is an integer compare; < compares the text, which keeps the sorted
+   lists in the same order as with plain strings.
+*/
+
+class Atom
+{
+	public:
+
+		Atom();
+
+		const std::string& str() const { return *str_; }
+
+		operator const std::string&() const { return *str_; }
+
+		std::string::size_type size() const { return str_->size(); }
+
+		bool empty() const { return str_->empty(); }
+
+		bool operator==(const Atom& other) const { return str_ == other.str_; }
+
+		bool operator!=(const Atom& other) const { return str_ != other.str_; }
+
+		bool operator<(const Atom& other) const { return str_ != other.str_ && *str_ < *other.str_; }
+
+		bool operator>(const Atom& other) const { return other < *this; }
+
+	private:
+
+		friend class StringPool;
+
+		explicit Atom(const std::string* str) : str_(str) {}
+
+		const std::string* str_;
+};
+
+/* std::string's operator+ is a template, it doesn't convert an Atom by itself
+*/
+
+	std::string operator+(const Atom& a, const char* b);
+
+	std::string operator+(const char* a, const Atom& b);
+
+	std::ostream& operator<<(std::ostream& out, const Atom& atom);
+
+/* the identifiers and definitions read from the dumps; the same text is
+   stored only once. intern() may be called from several threads.
+   Nothing is ever removed from a pool: it only grows until the last
+   shared_ptr to it is gone, then it is freed as a whole.
+*/
+
+class StringPool
+{
+	public:
+
+		Atom intern(std::string_view str);
+
+/* the pool of the current run: the one the table lists, parsers and emitters
+   still alive hold, a new one if there is none (atoms of different pools
+   never compare equal, so everything compared has to be alive at the same
+   time; main() holds it for the whole run)
+*/
+
+		static std::shared_ptr<StringPool> shared();
+
+	private:
+
+		static const std::size_t SHARDS = 16;
+
+		struct Shard {
+			std::mutex lock;
+			std::deque<std::string> strings;
+			std::unordered_map<std::string_view, const std::string*> index;
+		};
+
+		Shard shards_[SHARDS];
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,145 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "TableStats.hpp"
+
+namespace sqlfileparser
+{
+
+namespace
+{
+
+/* the line cut at the separator, blanks and quotes around the fields removed
+*/
+
+std::vector<std::string>
+splitFields(const std::string& line, char separator)
+{
+	std::vector<std::string> fields;
+	std::string::size_type from = 0;
+
+	while (from <= line.size())
+	{
+		std::string::size_type to = line.find(separator, from);
+		if (to == std::string::npos)
+		{
+			to = line.size();
+		}
+
+		std::string field(line.substr(from, to - from));
+
+		const std::string::size_type first = field.find_first_not_of(" \t\r");
+		const std::string::size_type last = field.find_last_not_of(" \t\r");
+		field = (first == std::string::npos) ? std::string() : field.substr(first, last - first + 1);
+
+		if (field.size() >= 2 && (field[0] == '"' || field[0] == '\'' || field[0] == '`') && field[field.size() - 1] == field[0])
+		{
+			field = field.substr(1, field.size() - 2);
+		}
+
+		fields.push_back(field);
+		from = to + 1;
+	}
+
+	return fields;
+}
+
+bool
+parseNumber(const std::string& field, std::uint64_t& value)
+{
+	if (field.empty())
+	{
+		value = 0;
+		return true;
+	}
+
+	char* end = 0;
+	value = std::strtoull(field.c_str(), &end, 10);
+
+	return field[0] != '-' && *end == 0;
+}
+
+/* "shop.orders" is orders, the names in the dumps aren't qualified
+*/
+
+std::string
+tableName(const std::string& field)
+{
+	const std::string::size_type dot = field.rfind('.');
+	std::string name((dot == std::string::npos) ? field : field.substr(dot + 1));
+
+	const std::string::size_type first = name.find_first_not_of('`');
+	const std::string::size_type last = name.find_last_not_of('`');
+
+	return (first == std::string::npos) ? std::string() : name.substr(first, last - first + 1);
+}
+
+} // anonymous namespace
+
+TableSizeMap
+loadTableStats(const std::string& fname)
+{
+	std::ifstream file(fname.c_str());
+	if (!file.good())
+	{
+		throw std::runtime_error("cannot open file " + fname + " for reading.");
+	}
+
+	TableSizeMap sizes;
+	std::string line;
+	unsigned int lineNumber = 0;
+	bool header = true;
+
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+
+		const std::string::size_type start = line.find_first_not_of(" \t\r");
+		if (start == std::string::npos || line[start] == '#')
+		{
+			continue;
+		}
+
+		const std::vector<std::string> fields(splitFields(line, (line.find('\t') != std::string::npos) ? '\t' : ','));
+
+		TableSize size;
+		bool numbers = fields.size() >= 4 &&
+			parseNumber(fields[1], size.rows) &&
+			parseNumber(fields[2], size.dataLength) &&
+			parseNumber(fields[3], size.indexLength);
+
+		if (!numbers)
+		{
+
+/* the column names, on the first line
+*/
+
+			if (header && fields.size() >= 4)
+			{
+				header = false;
+				continue;
+			}
+
+			throw std::runtime_error("bad line " + std::to_string(lineNumber) + " in the table stats file " + fname +
+				", expecting: table, rows, data_length, index_length");
+		}
+
+		header = false;
+		sizes[tableName(fields[0])] = size;
+	}
+
+	if (file.bad())
+	{
+		throw std::runtime_error("error while reading " + fname);
+	}
+
+	return sizes;
+}
+
+} //namespace
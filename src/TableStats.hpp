@@ -0,0 +1,45 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+#ifndef TABLESTATS_HPP
+#define TABLESTATS_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace sqlfileparser
+{
+
+/* what information_schema.tables says about a table
+*/
+
+struct TableSize {
+
+	TableSize()
+	:rows(0),
+	dataLength(0),
+	indexLength(0)
+	{
+	}
+
+	std::uint64_t rows, dataLength, indexLength;
+};
+
+/* by table name, without the schema
+*/
+
+typedef std::map<std::string, TableSize> TableSizeMap;
+
+/* a CSV or TSV export, one table per line: name, rows, data_length,
+   index_length; the name may be prefixed by its schema ("shop.orders") and
+   any field may be quoted. A header line, blank lines and "#" comments are
+   skipped; throws on anything else it can't read.
+*/
+
+	TableSizeMap loadTableStats(const std::string& fname);
+
+} // namespace
+
+#endif
@@ -6,83 +6,606 @@
 #include "configure.h"
 #endif
 
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
+#include <future>
+#include <memory>
+#include <vector>
 
 #include "LexParser.hpp"
 #include "SQLFileParser.hpp"
+#include "DiffEmitter.hpp"
+#include "MigrationPlan.hpp"
+#include "TableStats.hpp"
+#include "Hash.hpp"
+#include "OutputSink.hpp"
+#include "Parallel.hpp"
+#include "LazyLexParse.hpp"
+#include "Snapshot.hpp"
+#include "ResultCache.hpp"
+#include "Pipeline.hpp"
+#include "ParallelLexParse.hpp"
 
 using namespace sqlfileparser;
 
-int
-main(int argc, char* argv[])
+namespace
+{
+
+unsigned int
+parseCount(const std::string& option, const std::string& value)
+{
+	std::istringstream istr(value);
+	unsigned int count;
+
+	if (!(istr >> count) || !istr.eof())
+	{
+		throw std::runtime_error("Bad value \"" + value + "\" for option " + option);
+	}
+
+	return count;
+}
+
+/* the upgrade script goes to the file named after the versions, if any, to
+   stdout otherwise
+*/
+
+std::ostream&
+openOutput(int argc, char* argv[], int pos, std::ofstream& file)
 {
+	if (pos == argc)
+	{
+		return std::cout;
+	}
+
+	file.open(argv[pos]);
+	if (!file.good())
+	{
+		throw std::runtime_error("cannot open file " + std::string(argv[pos]) + " for writing.");
+	}
+
+	return file;
+}
+
+/* the script was copied into the cache while it was written; the result cache
+   is only an optimization, a script it can't store is still a good script
+*/
+
+void
+commitCachedResult(ResultCacheWriter* writer)
+{
+	if (writer == 0)
+	{
+		return;
+	}
+
 	try
 	{
-		if (argc < 3 || argc > 5)
+		writer->commit();
+	}
+	catch(std::exception& ex)
+	{
+		std::cerr << "WARNING: " << ex.what() << std::endl;
+	}
+}
+
+/* "dumps/v1.sql.gz" is v1, "dumps/v2/" is v2
+*/
+
+std::string
+versionName(const std::string& fname)
+{
+	std::filesystem::path path(fname);
+	std::string name(path.filename().string());
+	if (name.empty())
+	{
+		name = path.parent_path().filename().string();
+	}
+
+	static const char* suffixes[] = { ".gz", ".zst", ".xz", ".sql" };
+	for (std::size_t i = 0 ; i < sizeof(suffixes) / sizeof(suffixes[0]) ; ++i)
+	{
+		const std::string suffix(suffixes[i]);
+		if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
 		{
-			throw std::runtime_error("Wrong number of parameters; usage: " + std::string(argv[0]) + " [--skip-modified-timestamps] version1.sql version2.sql [ upgrade.sql ]");
+			name.erase(name.size() - suffix.size());
 		}
+	}
+
+	return name;
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char* argv[])
+{
+	try
+	{
+		const std::string usage("usage: " + std::string(argv[0]) + " [--skip-modified-timestamps] [--skip-column-moves] [--no-column-renames] [--rename-threshold 0..1] [--detect-table-renames] [--single-alter] [--online-ddl] [--format sql|json] [--plan [--stats FILE] [--throughput MBPS]] [--threads N] [--lazy] [--stream] [--pipeline] [--cache-dir DIR] [--result-cache DIR] version1.sql|dir version2.sql|dir [ upgrade.sql ]\n"
+			"       " + std::string(argv[0]) + " [options] --chain DIR [--compose] version1.sql|dir version2.sql|dir ... versionN.sql|dir");
 
 		int pstart = 1;
-		const std::string skip_modified("--skip-modified-timestamps");
 		bool skipModifiedTimestampsFunction = false;
+		bool skipColumnMoves = false;
+		double renameThreshold = DEFAULT_RENAME_THRESHOLD;
+		bool columnRenames = true;
+		bool tableRenames = false;
+		bool singleAlter = false;
+		bool onlineDDL = false;
+		bool plan = false;
+		std::string statsFile;
+		double throughput = 0;
+		std::string format("sql");
+		unsigned int threads = 1;
+		bool lazy = false;
+		bool stream = false;
+		bool pipeline = false;
+		std::string cacheDir;
+		std::string resultCache;
+		std::string chainDir;
+		bool compose = false;
+
+/* the options changing the upgrade script, for the --result-cache key
+*/
+
+		std::string outputOptions;
 
-		if (skip_modified.compare(0, 2, argv[1], 2) == 0)
+/* options first, then the file names
+*/
+
+		while (pstart < argc && std::string(argv[pstart]).compare(0, 2, "--") == 0)
 		{
-			if (skip_modified.compare(argv[1]) == 0)
+			const std::string option(argv[pstart++]);
+
+			if (option == "--skip-modified-timestamps")
 			{
 				skipModifiedTimestampsFunction = true;
-				pstart++;
+				outputOptions += option + " ";
+			}
+			else if (option == "--skip-column-moves")
+			{
+				skipColumnMoves = true;
+				outputOptions += option + " ";
+			}
+			else if (option == "--no-column-renames")
+			{
+				columnRenames = false;
+				outputOptions += option + " ";
+			}
+			else if (option == "--rename-threshold")
+			{
+				if (pstart == argc)
+				{
+					throw std::runtime_error("Missing value for option " + option + "; " + usage);
+				}
+				const std::string value(argv[pstart++]);
+				std::istringstream istr(value);
+				if (!(istr >> renameThreshold) || !istr.eof() || renameThreshold < 0 || renameThreshold > 1)
+				{
+					throw std::runtime_error("Bad value \"" + value + "\" for option " + option);
+				}
+				outputOptions += option + " " + value + " ";
+			}
+			else if (option == "--detect-table-renames")
+			{
+				tableRenames = true;
+				outputOptions += option + " ";
+			}
+			else if (option == "--single-alter")
+			{
+				singleAlter = true;
+				outputOptions += option + " ";
+			}
+			else if (option == "--online-ddl")
+			{
+				onlineDDL = true;
+				outputOptions += option + " ";
+			}
+			else if (option == "--plan")
+			{
+				plan = true;
+				outputOptions += option + " ";
+			}
+			else if (option == "--stats")
+			{
+				if (pstart == argc)
+				{
+					throw std::runtime_error("Missing value for option " + option + "; " + usage);
+				}
+				statsFile = argv[pstart++];
+			}
+			else if (option == "--throughput")
+			{
+				if (pstart == argc)
+				{
+					throw std::runtime_error("Missing value for option " + option + "; " + usage);
+				}
+				const std::string value(argv[pstart++]);
+				std::istringstream istr(value);
+				if (!(istr >> throughput) || !istr.eof() || throughput <= 0)
+				{
+					throw std::runtime_error("Bad value \"" + value + "\" for option " + option);
+				}
+				outputOptions += option + " " + value + " ";
+			}
+			else if (option == "--format")
+			{
+				if (pstart == argc)
+				{
+					throw std::runtime_error("Missing value for option " + option + "; " + usage);
+				}
+				format = argv[pstart++];
+				if (format != "sql" && format != "json")
+				{
+					throw std::runtime_error("Bad value \"" + format + "\" for option " + option);
+				}
+				outputOptions += option + " " + format + " ";
+			}
+			else if (option == "--threads")
+			{
+				if (pstart == argc)
+				{
+					throw std::runtime_error("Missing value for option " + option + "; " + usage);
+				}
+				threads = parseCount(option, argv[pstart++]);
+				if (threads == 0)
+				{
+					threads = defaultThreadCount();
+				}
+			}
+			else if (option == "--cache-dir")
+			{
+				if (pstart == argc)
+				{
+					throw std::runtime_error("Missing value for option " + option + "; " + usage);
+				}
+				cacheDir = argv[pstart++];
+			}
+			else if (option == "--result-cache")
+			{
+				if (pstart == argc)
+				{
+					throw std::runtime_error("Missing value for option " + option + "; " + usage);
+				}
+				resultCache = argv[pstart++];
+			}
+			else if (option == "--chain")
+			{
+				if (pstart == argc)
+				{
+					throw std::runtime_error("Missing value for option " + option + "; " + usage);
+				}
+				chainDir = argv[pstart++];
+			}
+			else if (option == "--compose")
+			{
+				compose = true;
+			}
+			else if (option == "--lazy")
+			{
+				lazy = true;
+			}
+			else if (option == "--stream" || option == "--pipeline")
+			{
+
+/* --pipeline is --stream on several threads, with the same output
+*/
+
+				if (!stream)
+				{
+					outputOptions += "--stream ";
+				}
+				stream = true;
+				pipeline = pipeline || (option == "--pipeline");
+			}
+			else
+			{
+				throw std::runtime_error("Unknown option: " + option);
+			}
+		}
+
+		if (argc - pstart < 2 || (argc - pstart > 3 && chainDir.empty()))
+		{
+			throw std::runtime_error("Wrong number of parameters; " + usage);
+		}
+
+		if (!columnRenames)
+		{
+			renameThreshold = NO_COLUMN_RENAMES;
+		}
+
+/* a table can only be taken for a renamed one once every table has been read
+*/
+
+		if (tableRenames && stream)
+		{
+			throw std::runtime_error("Option --detect-table-renames can't be used with --stream or --pipeline");
+		}
+
+		if (!chainDir.empty() && (stream || lazy))
+		{
+			throw std::runtime_error("Options --stream, --pipeline and --lazy compare two versions, they can't be used with --chain");
+		}
+
+		if (compose && chainDir.empty())
+		{
+			throw std::runtime_error("Option --compose only applies to --chain");
+		}
+
+		if (singleAlter && format != "sql")
+		{
+			throw std::runtime_error("Option --single-alter only applies to the sql format");
+		}
+
+		if (plan && format != "sql")
+		{
+			throw std::runtime_error("Option --plan writes a report of its own, it can't be used with --format");
+		}
+
+		if (!plan && (!statsFile.empty() || throughput > 0))
+		{
+			throw std::runtime_error("Options --stats and --throughput only apply to --plan");
+		}
+
+/* the plan depends on the sizes in the stats file, not on its name
+*/
+
+		if (!statsFile.empty() && !resultCache.empty())
+		{
+			outputOptions += "--stats " + hashFile(statsFile).hex() + " ";
+		}
+
+/* every version read during the run goes into this pool, whatever gets
+   released in between; it is freed when the run is over
+*/
+
+		const std::shared_ptr<StringPool> pool(StringPool::shared());
+
+		TableSizeMap sizes;
+		if (!statsFile.empty())
+		{
+			sizes = loadTableStats(statsFile);
+		}
+
+		auto makeEmitter = [&] (OutputSink& sink) {
+			std::unique_ptr<DiffEmitter> emitter;
+			if (plan)
+			{
+
+/* 50 MB/s is about what a rebuild does on a busy server with ordinary disks
+*/
+
+				emitter.reset(new PlanEmitter(sink, sizes, (throughput > 0) ? throughput : 50, skipColumnMoves, singleAlter));
+			}
+			else if (format == "json")
+			{
+				emitter.reset(new JSONEmitter(sink, onlineDDL));
 			}
 			else
 			{
-				throw std::runtime_error("Unknown option: " + std::string(argv[1]));
+				emitter.reset(new SQLEmitter(sink, skipColumnMoves, singleAlter, onlineDDL));
+			}
+			return emitter;
+		};
+
+		if (!chainDir.empty())
+		{
+
+/* a release train: one script per step, v1 to v2, v2 to v3..., into chainDir,
+   and with --compose one from v1 straight to vN. Every version is parsed once
+   and kept until its last script; a script found in the result cache needs
+   neither of its versions.
+*/
+
+			const std::vector<std::string> versions(argv + pstart, argv + argc);
+			const std::size_t steps = versions.size() - 1;
+			const std::string extension(plan ? ".txt" : ((format == "json") ? ".json" : ".sql"));
+			const int digits = static_cast<int>(std::to_string(steps).size());
+
+			std::vector<std::pair<std::size_t, std::size_t> > scripts;
+			for (std::size_t i = 0 ; i < steps ; ++i)
+			{
+				scripts.push_back(std::make_pair(i, i + 1));
+			}
+			if (compose && steps > 1)
+			{
+				scripts.push_back(std::make_pair(std::size_t(0), steps));
+			}
+
+/* 1-v1-to-v2.sql ... and v1-to-vN.sql for the composed one
+*/
+
+			std::vector<std::string> scriptFiles, resultFiles;
+			std::vector<bool> needed(versions.size(), false);
+
+			for (std::size_t i = 0 ; i < scripts.size() ; ++i)
+			{
+				const std::size_t from = scripts[i].first, to = scripts[i].second;
+
+				std::ostringstream name;
+				if (i < steps)
+				{
+					name << std::setw(digits) << std::setfill('0') << (i + 1) << "-";
+				}
+				name << versionName(versions[from]) << "-to-" << versionName(versions[to]) << extension;
+				scriptFiles.push_back((std::filesystem::path(chainDir) / name.str()).string());
+
+				resultFiles.push_back(resultCache.empty() ? std::string() : resultCacheFile(resultCache, versions[from], versions[to], outputOptions));
+				if (resultFiles.back().empty() || !isCachedResult(resultFiles.back()))
+				{
+					needed[from] = needed[to] = true;
+				}
+			}
+
+			std::filesystem::create_directories(chainDir);
+
+/* all the versions at the same time, sharing the threads
+*/
+
+			std::vector<SQLTableListManagerPtr> managers(versions.size());
+			const unsigned int fileThreads = std::max(1u, threads / static_cast<unsigned int>(versions.size()));
+
+			parallelFor(versions.size(), threads, [&] (std::size_t i) {
+				if (needed[i])
+				{
+					managers[i] = lexParseCached(versions[i], skipModifiedTimestampsFunction, fileThreads, cacheDir, std::cerr);
+				}
+			});
+
+			for (std::size_t i = 0 ; i < scripts.size() ; ++i)
+			{
+				std::ofstream file(scriptFiles[i].c_str());
+				if (!file.good())
+				{
+					throw std::runtime_error("cannot open file " + scriptFiles[i] + " for writing.");
+				}
+
+				if (!resultFiles[i].empty() && isCachedResult(resultFiles[i]))
+				{
+					printCachedResult(resultFiles[i], file);
+					continue;
+				}
+
+				OutputSink sink(file);
+				std::unique_ptr<ResultCacheWriter> cacheWriter(resultFiles[i].empty() ? 0 : new ResultCacheWriter(resultFiles[i]));
+				if (cacheWriter)
+				{
+					sink.tee(cacheWriter->stream());
+				}
+
+				SQLFileParser parser(managers[scripts[i].first], managers[scripts[i].second], threads, renameThreshold, tableRenames);
+				parser.print(*makeEmitter(sink));
+				sink.flush();
+
+				commitCachedResult(cacheWriter.get());
+
+/* the middle versions are done with after their second step (their strings
+   stay in the pool); the first and the last one may still be composed
+*/
+
+				if (i < steps && scripts[i].first > 0)
+				{
+					managers[scripts[i].first].reset();
+				}
 			}
+
+			return 0;
 		}
 
-		std::ifstream inp1(argv[pstart]), inp2(argv[pstart + 1]);
+/* a script generated earlier from the same files with the same options is
+   printed as it is, nothing gets parsed
+*/
 
-		if (!inp1.good())
+		std::string resultFile;
+		std::ofstream outFile;
+
+		if (!resultCache.empty())
 		{
-			throw std::runtime_error("cannot open file " + std::string(argv[pstart]) + " for reading.");
+			resultFile = resultCacheFile(resultCache, argv[pstart], argv[pstart + 1], outputOptions);
+			if (!resultFile.empty() && isCachedResult(resultFile))
+			{
+				printCachedResult(resultFile, openOutput(argc, argv, pstart + 2, outFile));
+				return 0;
+			}
 		}
 
-		if (!inp2.good())
+		SQLTableListManagerPtr psm1, psm2;
+		std::unique_ptr<SQLFileParser> sqlParser;
+
+		if (stream)
 		{
-			throw std::runtime_error("cannot open file " + std::string(argv[pstart + 1]) + " for reading.");
+
+/* --stream only loads the first version; the second one is compared table by
+   table while it is being read, see below
+*/
+
+			psm1 = lexParseCached(argv[pstart], skipModifiedTimestampsFunction, threads, cacheDir, std::cerr);
+			sqlParser.reset(new SQLFileParser(psm1, renameThreshold));
 		}
+		else
+		{
 
-		SQLTableListManagerPtr psm1 = lexParse(inp1, skipModifiedTimestampsFunction), psm2 = lexParse(inp2, skipModifiedTimestampsFunction);
+/* --lazy only parses the tables that differ; if it can't be used on these files
+   both versions are parsed at the same time (or loaded from the --cache-dir
+   snapshots); get() rethrows whatever the parser threw
+*/
+
+			if (!lazy || !lexParseChanged(argv[pstart], argv[pstart + 1], skipModifiedTimestampsFunction, threads, std::cerr, psm1, psm2))
+			{
+				std::future<SQLTableListManagerPtr> fpsm1 = std::async(std::launch::async, [&] { return lexParseCached(argv[pstart], skipModifiedTimestampsFunction, threads, cacheDir, std::cerr); });
+				std::future<SQLTableListManagerPtr> fpsm2 = std::async(std::launch::async, [&] { return lexParseCached(argv[pstart + 1], skipModifiedTimestampsFunction, threads, cacheDir, std::cerr); });
+
+				psm1 = fpsm1.get();
+				psm2 = fpsm2.get();
+			}
 
 #ifdef DEBUG
 
-		std::ofstream debug1("debug1.txt");
-		psm1->print(debug1);
+			std::ofstream debug1("debug1.txt");
+			psm1->print(debug1);
 
-		std::ofstream debug2("debug2.txt");
-		psm2->print(debug2);
+			std::ofstream debug2("debug2.txt");
+			psm2->print(debug2);
 
 #endif
 
-		SQLFileParser sqlParser(psm1, psm2);
+			sqlParser.reset(new SQLFileParser(psm1, psm2, threads, renameThreshold, tableRenames));
+		}
+
+		std::ostream& out = openOutput(argc, argv, pstart + 2, outFile);
+
+/* with a result cache every block written goes to the cache file as well, so
+   --stream still prints as it goes and holds nothing more
+*/
+
+		OutputSink sink(out);
+		std::unique_ptr<ResultCacheWriter> cacheWriter(resultFile.empty() ? 0 : new ResultCacheWriter(resultFile));
+		if (cacheWriter)
+		{
+			sink.tee(cacheWriter->stream());
+		}
 
-		if (argc == pstart + 3)
+		std::unique_ptr<DiffEmitter> emitter(makeEmitter(sink));
+
+		if (stream)
 		{
-			std::ofstream out;
-			out.open(argv[pstart + 2]);
-			if (!out.good())
+
+/* every table is written out as soon as it has been compared, then dropped
+*/
+
+			emitter->begin();
+
+/* with --pipeline reading, scanning, comparing and writing each get a thread;
+   a directory is still read one file after the other
+*/
+
+			if (pipeline && !isDumpDirectory(argv[pstart + 1]))
+			{
+				diffPipelined(argv[pstart + 1], skipModifiedTimestampsFunction, *sqlParser, *emitter, sink, std::cerr);
+			}
+			else
 			{
-				throw std::runtime_error("cannot open file " + std::string(argv[pstart + 2]) + " for writing.");
+				lexParseStreaming(argv[pstart + 1], skipModifiedTimestampsFunction, [&] (SQLTable& table) {
+					sqlParser->streamTable(table, *emitter);
+					sink.flush();
+				}, std::cerr);
 			}
-			sqlParser.print(out);
+
+			sqlParser->finish(*emitter);
+			emitter->end();
 		}
 		else
 		{
-			sqlParser.print(std::cout);
+			sqlParser->print(*emitter);
 		}
 
+		sink.flush();
+		commitCachedResult(cacheWriter.get());
 	}
 	catch(std::exception &ex)
 	{
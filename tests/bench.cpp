@@ -0,0 +1,427 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+/* what the table model costs: the heap and the resident memory once both
+   versions are parsed, and the time the diff and the printing take, apart
+   from the parsing (the script goes to /dev/null).
+   The same tables are then copied into the model they had before the flat
+   vectors (strings in a deque, a map and sets, every table twice) and the
+   same merge of the two versions runs on both models, for the comparison
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "configure.h"
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#ifdef HAVE_MALLINFO2
+#include <malloc.h>
+#endif
+
+#include "LexParser.hpp"
+#include "SQLFileParser.hpp"
+#include "DiffEmitter.hpp"
+#include "OutputSink.hpp"
+
+using namespace sqlfileparser;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double
+seconds(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::string
+megabytes(std::uint64_t bytes)
+{
+	char text[32];
+	std::snprintf(text, sizeof(text), "%.1f MB", bytes / 1048576.0);
+
+	return text;
+}
+
+/* 0 where the C library can't tell
+*/
+
+std::uint64_t
+heapInUse()
+{
+#ifdef HAVE_MALLINFO2
+	const struct mallinfo2 info = mallinfo2();
+
+	return info.uordblks + info.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+std::uint64_t
+residentMemory()
+{
+	std::ifstream statm("/proc/self/statm");
+	std::uint64_t size, resident;
+
+	if (!(statm >> size >> resident))
+	{
+		return 0;
+	}
+
+	return resident * static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+}
+
+std::uint64_t
+peakResidentMemory()
+{
+	struct rusage usage;
+	if (::getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+
+/* kilobytes on Linux, bytes on macOS
+*/
+
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+std::string
+memory(std::uint64_t bytes)
+{
+	return (bytes == 0) ? std::string("n/a") : megabytes(bytes);
+}
+
+/* the table model before the flat vectors, node based containers of strings
+*/
+
+struct NodeTable {
+
+	std::string name, tabletype;
+
+	std::deque<std::string> fields;
+
+	std::map<std::string, std::string> indexedfields;
+
+	std::set<std::pair<std::string, std::string> > primary, foreign, noindex, index, unique, fulltext, spatial;
+
+	Hash128 fingerprint;
+
+	bool operator<(const NodeTable& other) const { return name < other.name; }
+
+	const std::string& definition(const std::string& field) const { return indexedfields.at(field); }
+};
+
+/* the tables in file order, and a copy of each sorted by name
+*/
+
+struct NodeTableList {
+
+	std::deque<NodeTable> raw;
+
+	std::set<NodeTable> sorted;
+};
+
+void
+copyNodes(const TableIndexList& from, std::set<std::pair<std::string, std::string> >& to)
+{
+	for (TableIndexList::const_iterator it = from.begin() ; it != from.end() ; ++it)
+	{
+		to.insert(std::make_pair(it->first.str(), it->second.str()));
+	}
+}
+
+void
+copyTables(const SQLTableRawList& from, NodeTableList& to)
+{
+	for (SQLTableRawList::const_iterator it = from.begin() ; it != from.end() ; ++it)
+	{
+		NodeTable table;
+		table.name = it->name;
+		table.tabletype = it->tabletype;
+		table.fields.assign(it->fields.begin(), it->fields.end());
+
+		for (TableNodeMap::const_iterator f = it->indexedfields.begin() ; f != it->indexedfields.end() ; ++f)
+		{
+			table.indexedfields.insert(std::make_pair(f->first.str(), f->second.str()));
+		}
+
+		copyNodes(it->primary, table.primary);
+		copyNodes(it->foreign, table.foreign);
+		copyNodes(it->noindex, table.noindex);
+		copyNodes(it->index, table.index);
+		copyNodes(it->unique, table.unique);
+		copyNodes(it->fulltext, table.fulltext);
+		copyNodes(it->spatial, table.spatial);
+		table.fingerprint = it->fingerprint;
+
+		to.raw.push_back(table);
+		to.sorted.insert(table);
+	}
+}
+
+const NodeTable&
+tableAt(std::set<NodeTable>::const_iterator it)
+{
+	return *it;
+}
+
+const SQLTable&
+tableAt(SQLTableList::const_iterator it)
+{
+	return **it;
+}
+
+/* the merge loops of the diff on either model: two sorted lists walked side
+   by side, one line of script for every difference
+*/
+
+template<typename Name, typename Nodes>
+void
+mergeNodes(const Name& table, const char* kind, const Nodes& nodes1, const Nodes& nodes2, OutputSink& out)
+{
+	typename Nodes::const_iterator it1 = nodes1.begin(), it2 = nodes2.begin();
+
+	while (it1 != nodes1.end() || it2 != nodes2.end())
+	{
+		if (it2 == nodes2.end() || (it1 != nodes1.end() && it1->first < it2->first))
+		{
+			out << "alter table " << table << " drop " << kind << ' ' << it1->first << ";\n";
+			++it1;
+		}
+		else if (it1 == nodes1.end() || it2->first < it1->first)
+		{
+			out << "alter table " << table << " add " << kind << ' ' << it2->first << ' ' << it2->second << ";\n";
+			++it2;
+		}
+		else
+		{
+			if (it1->second != it2->second)
+			{
+				out << "alter table " << table << " modify " << kind << ' ' << it2->first << ' ' << it2->second << ";\n";
+			}
+			++it1;
+			++it2;
+		}
+	}
+}
+
+template<typename Table>
+void
+createTable(const Table& table, OutputSink& out)
+{
+	out << "create table " << table.name << "\n(\n";
+	for (std::size_t i = 0 ; i < table.fields.size() ; ++i)
+	{
+		out << '\t' << table.fields[i] << ' ' << table.definition(table.fields[i]) << ",\n";
+	}
+	out << ") " << table.tabletype << ";\n";
+}
+
+template<typename Tables>
+void
+mergeTables(const Tables& tables1, const Tables& tables2, OutputSink& out)
+{
+	typename Tables::const_iterator it1 = tables1.begin(), it2 = tables2.begin();
+
+	while (it1 != tables1.end() || it2 != tables2.end())
+	{
+		if (it2 == tables2.end() || (it1 != tables1.end() && tableAt(it1).name < tableAt(it2).name))
+		{
+			out << "drop table " << tableAt(it1).name << ";\n";
+			++it1;
+		}
+		else if (it1 == tables1.end() || tableAt(it2).name < tableAt(it1).name)
+		{
+			createTable(tableAt(it2), out);
+			++it2;
+		}
+		else
+		{
+			const auto& table1 = tableAt(it1);
+			const auto& table2 = tableAt(it2);
+
+			if (!(table1.fingerprint == table2.fingerprint))
+			{
+				mergeNodes(table2.name, "column", table1.indexedfields, table2.indexedfields, out);
+				mergeNodes(table2.name, "primary key", table1.primary, table2.primary, out);
+				mergeNodes(table2.name, "foreign key", table1.foreign, table2.foreign, out);
+				mergeNodes(table2.name, "index", table1.index, table2.index, out);
+				mergeNodes(table2.name, "unique", table1.unique, table2.unique, out);
+				mergeNodes(table2.name, "fulltext", table1.fulltext, table2.fulltext, out);
+				mergeNodes(table2.name, "spatial", table1.spatial, table2.spatial, out);
+			}
+			++it1;
+			++it2;
+		}
+	}
+}
+
+/* the best and the mean time of "runs" merges into /dev/null
+*/
+
+template<typename Tables>
+std::pair<double, double>
+timeMerge(const Tables& tables1, const Tables& tables2, unsigned int runs)
+{
+	double best = 0, total = 0;
+
+	for (unsigned int run = 0 ; run < runs ; ++run)
+	{
+		std::ofstream null("/dev/null");
+		OutputSink sink(null);
+
+		const Clock::time_point start = Clock::now();
+		mergeTables(tables1, tables2, sink);
+		sink.flush();
+		const double elapsed = seconds(start);
+
+		best = (run == 0 || elapsed < best) ? elapsed : best;
+		total += elapsed;
+	}
+
+	return std::make_pair(best, total / runs);
+}
+
+unsigned int
+parseCount(const std::string& option, const std::string& value)
+{
+	std::istringstream istr(value);
+	unsigned int count;
+
+	if (!(istr >> count) || !istr.eof() || count == 0)
+	{
+		throw std::runtime_error("Bad value \"" + value + "\" for option " + option);
+	}
+
+	return count;
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char* argv[])
+{
+	try
+	{
+		const std::string usage("usage: " + std::string(argv[0]) + " [--threads N] [--runs N] version1.sql|dir version2.sql|dir");
+
+		unsigned int threads = 1, runs = 5;
+		int pstart = 1;
+
+		while (pstart < argc && std::string(argv[pstart]).compare(0, 2, "--") == 0)
+		{
+			const std::string option(argv[pstart++]);
+			if (pstart == argc)
+			{
+				throw std::runtime_error("Missing value for option " + option + "; " + usage);
+			}
+
+			if (option == "--threads")
+			{
+				threads = parseCount(option, argv[pstart++]);
+			}
+			else if (option == "--runs")
+			{
+				runs = parseCount(option, argv[pstart++]);
+			}
+			else
+			{
+				throw std::runtime_error("Unknown option: " + option);
+			}
+		}
+
+		if (argc - pstart != 2)
+		{
+			throw std::runtime_error("Wrong number of parameters; " + usage);
+		}
+
+		const std::uint64_t heapBefore = heapInUse();
+
+		Clock::time_point start = Clock::now();
+		SQLTableListManagerPtr psm1 = lexParse(argv[pstart], false, threads, std::cerr);
+		const double parse1 = seconds(start);
+
+		start = Clock::now();
+		SQLTableListManagerPtr psm2 = lexParse(argv[pstart + 1], false, threads, std::cerr);
+		const double parse2 = seconds(start);
+
+		const std::uint64_t heap = heapInUse() - heapBefore;
+		const std::uint64_t resident = residentMemory();
+		const std::uint64_t peak = peakResidentMemory();
+
+/* the best of a few runs: the first one also warms the caches up
+*/
+
+		double best = 0, total = 0;
+		std::uint64_t written = 0;
+
+		for (unsigned int run = 0 ; run < runs ; ++run)
+		{
+			std::ofstream null("/dev/null");
+			OutputSink sink(null);
+			SQLEmitter emitter(sink);
+
+			start = Clock::now();
+			SQLFileParser parser(psm1, psm2, threads);
+			parser.print(emitter);
+			sink.flush();
+			const double elapsed = seconds(start);
+
+			best = (run == 0 || elapsed < best) ? elapsed : best;
+			total += elapsed;
+			written = sink.written();
+		}
+
+/* the model before, built from the same tables
+*/
+
+		const std::uint64_t nodeHeapBefore = heapInUse();
+		NodeTableList nodes1, nodes2;
+		copyTables(psm1->rawtlist(), nodes1);
+		copyTables(psm2->rawtlist(), nodes2);
+		const std::uint64_t nodeHeap = heapInUse() - nodeHeapBefore;
+
+		const std::pair<double, double> nodeMerge = timeMerge(nodes1.sorted, nodes2.sorted, runs);
+		const std::pair<double, double> flatMerge = timeMerge(psm1->tlist(), psm2->tlist(), runs);
+
+		std::cout << "tables        " << psm1->rawtlist().size() << " + " << psm2->rawtlist().size() << "\n";
+		std::printf("parse         %.2f s + %.2f s\n", parse1, parse2);
+		std::cout << "heap          " << memory(heap) << " after parsing both versions\n";
+		std::cout << "rss           " << memory(resident) << " after parsing, " << memory(peak) << " peak\n";
+		std::printf("diff+print    %.1f ms best, %.1f ms mean of %u runs (%s of script)\n",
+			best * 1000, total * 1000 / runs, runs, megabytes(written).c_str());
+		std::cout << "\nmodel         heap          diff+print (best, mean of " << runs << " runs)\n";
+		std::printf("node based    %-13s %.1f ms, %.1f ms\n", memory(nodeHeap).c_str(), nodeMerge.first * 1000, nodeMerge.second * 1000);
+		std::printf("flat          %-13s %.1f ms, %.1f ms\n", memory(heap).c_str(), flatMerge.first * 1000, flatMerge.second * 1000);
+	}
+	catch(std::exception &ex)
+	{
+		std::cerr << "Caught exception: " << ex.what() << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,20 @@
+#! /bin/sh
+# the benchmark of the table model: generates a pair of dumps of TABLES tables
+# (20000 by default) and reports the memory after parsing them and the time
+# the diff and the printing take, then the heap and the merge time of the same
+# tables in the node based model they had before the flat vectors; run from
+# the build directory of tests/ (or through "make benchmark")
+#
+# usage: bench.sh [TABLES [THREADS]]
+
+set -e
+
+tables=${1:-20000}
+threads=${2:-1}
+
+dir=${TMPDIR:-/tmp}/sqldiff-bench.$$
+mkdir -p "$dir"
+trap 'rm -rf "$dir"' EXIT INT TERM
+
+./gendump --tables "$tables" "$dir/version1.sql" "$dir/version2.sql"
+./bench --threads "$threads" "$dir/version1.sql" "$dir/version2.sql"
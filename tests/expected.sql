@@ -0,0 +1,89 @@
+alter table users modify column email varchar (320) not null;
+
+alter table users change column name display_name varchar (64) null;
+
+alter table users modify column status enum ('new','active','banned') default 'new' not null;
+
+alter table users add column last_login datetime null after status;
+
+alter table users drop index idx_status;
+
+alter table users add index idx_status_created (status,created_at);
+
+alter table orders modify column shipped tinyint default 0 not null after user_id;
+
+alter table orders modify column total decimal (12,2) not null;
+
+alter table orders add column currency char (3) default 'EUR' not null after total;
+
+alter table orders drop foreign key `fk_orders_user`;
+
+alter table orders add constraint `fk_orders_user` foreign key (user_id) references users (id) on delete cascade;
+
+alter table orders drop column note;
+
+create table order_items
+(
+	order_id int not null,
+	line int not null,
+	sku varchar (32) not null,
+	qty int default 1 not null,
+	price decimal (10,2) not null,
+	discount decimal (10,2) null,
+	primary key (order_id,line),
+	index idx_sku (sku)
+) engine=innodb default charset=utf8mb4;
+
+alter table articles modify column author varchar (100) null after title;
+
+alter table articles drop key ft_title;
+
+alter table articles add fulltext ft_title_body (title,body);
+
+create table event_log
+(
+	id bigint auto_increment not null,
+	actor int not null,
+	action varchar (50) not null,
+	payload json null,
+	logged_at datetime not null,
+	primary key (id),
+	index idx_actor (actor)
+) engine=innodb default charset=utf8mb4;
+
+create table stats_daily
+(
+	day date not null,
+	hits bigint not null,
+	visitors int default 0 not null,
+	primary key (day)
+) engine=innodb default charset=utf8mb4;
+
+create table labels
+(
+	id int auto_increment not null,
+	label varchar (50) not null,
+	color varchar (7) null,
+	weight smallint default 0 not null,
+	primary key (id),
+	unique u_label (label)
+) engine=innodb default charset=utf8mb4;
+
+alter table column_types modify column title varchar (20) character set utf8mb4 null;
+
+alter table column_types modify column ratio float (25) null;
+
+alter table column_types modify column serial int (8) unsigned zerofill not null;
+
+alter table column_types modify column small smallint (6) zerofill null;
+
+drop table audit_log;
+
+drop table legacy_stats;
+
+drop table order_lines;
+
+drop table sessions;
+
+drop table tags;
+
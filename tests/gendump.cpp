@@ -0,0 +1,368 @@
+/* Dan-Claudiu Dragos <dancld@yahoo.co.uk>
+* License: GPL
+*/
+
+/* writes a pair of mysqldump-like versions of a generated schema, the second
+   one derived from the first: some tables dropped, created or renamed, columns
+   added, dropped, modified, moved or renamed, keys added and dropped. The same
+   arguments always give the same files, on any platform (only the raw output
+   of mt19937_64 is used, never the standard distributions).
+*/
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+class Random
+{
+	public:
+
+		Random(std::uint64_t seed) : engine_(seed) {}
+
+/* from "low" to "high", both included
+*/
+
+		int range(int low, int high) { return low + static_cast<int>(engine_() % static_cast<std::uint64_t>(high - low + 1)); }
+
+		double real() { return (engine_() >> 11) * (1.0 / 9007199254740992.0); }
+
+		template<typename T>
+		const T& choice(const std::vector<T>& values) { return values[range(0, static_cast<int>(values.size()) - 1)]; }
+
+	private:
+
+		std::mt19937_64 engine_;
+};
+
+typedef std::pair<std::string, std::string> Column;
+
+struct Table {
+
+	std::string name;
+
+	std::vector<Column> columns;
+
+	std::vector<std::string> keys;
+};
+
+/* the keys without the duplicates, in their first order
+*/
+
+void
+addKey(Table& table, const std::string& key)
+{
+	for (std::vector<std::string>::const_iterator it = table.keys.begin() ; it != table.keys.end() ; ++it)
+	{
+		if (*it == key)
+		{
+			return;
+		}
+	}
+
+	table.keys.push_back(key);
+}
+
+std::vector<Table>
+generate(unsigned int count, std::uint64_t seed)
+{
+	static const std::vector<std::string> types = {
+		"int(11) NOT NULL", "int(11) DEFAULT NULL", "varchar(255) NOT NULL", "varchar(64) DEFAULT NULL",
+		"varchar(32) NOT NULL DEFAULT 'abc'", "text", "bigint(20) unsigned NOT NULL", "datetime DEFAULT NULL",
+		"tinyint(1) NOT NULL DEFAULT '0'", "decimal(10,2) DEFAULT NULL", "enum('a','b','c') NOT NULL DEFAULT 'a'",
+		"double NOT NULL"
+	};
+	static const char* common[] = { "name", "created_at", "status", "value", "user_id" };
+
+	Random random(seed);
+	std::vector<Table> tables(count);
+
+	for (unsigned int t = 0 ; t < count ; ++t)
+	{
+		Table& table = tables[t];
+		table.name = "t" + std::to_string(t);
+		table.columns.push_back(Column("id", "int(11) NOT NULL AUTO_INCREMENT"));
+
+		const int columns = random.range(2, 12);
+		for (int i = 0 ; i < columns ; ++i)
+		{
+			const std::string name = (random.real() < 0.5) ? "c" + std::to_string(t) + "_" + std::to_string(i) :
+				common[i % 5] + std::to_string(i);
+			table.columns.push_back(Column(name, random.choice(types)));
+		}
+
+		addKey(table, "PRIMARY KEY (`id`)");
+
+		const int keys = random.range(0, 3);
+		for (int i = 0 ; i < keys ; ++i)
+		{
+			const std::string& column = table.columns[random.range(1, static_cast<int>(table.columns.size()) - 1)].first;
+			addKey(table, (random.range(0, 1) == 0) ? "KEY `idx_" + column + "` (`" + column + "`)" :
+				"UNIQUE KEY `u_" + column + "` (`" + column + "`)");
+		}
+
+		if (t > 0 && random.real() < 0.3)
+		{
+			const std::string& column = table.columns[1].first;
+			const std::string fk = "fk_" + std::to_string(t);
+			addKey(table, "KEY `" + fk + "` (`" + column + "`)");
+			addKey(table, "CONSTRAINT `" + fk + "` FOREIGN KEY (`" + column + "`) REFERENCES `t" + std::to_string(t - 1) + "` (`id`)");
+		}
+	}
+
+	return tables;
+}
+
+/* half of the tables get one change each, 5% are dropped, 2% renamed and a
+   few are created
+*/
+
+std::vector<Table>
+mutate(const std::vector<Table>& tables, std::uint64_t seed)
+{
+	Random random(seed);
+	std::vector<Table> result;
+
+	for (std::vector<Table>::const_iterator it = tables.begin() ; it != tables.end() ; ++it)
+	{
+		const double x = random.real();
+		if (x < 0.05)
+		{
+			continue;
+		}
+
+		Table table(*it);
+		const int last = static_cast<int>(table.columns.size()) - 1;
+
+		if (x < 0.07)
+		{
+			table.name = "renamed_" + table.name;
+		}
+		else if (x < 0.5)
+		{
+			switch (random.range(0, 6))
+			{
+				case 0:
+					table.columns.insert(table.columns.begin() + random.range(1, last + 1),
+						Column("newcol" + std::to_string(random.range(0, 99)), "int(11) DEFAULT NULL"));
+					break;
+
+				case 1:
+					if (last > 1)
+					{
+						const int dropped = random.range(2, last);
+						const std::string column = "`" + table.columns[dropped].first + "`";
+						table.columns.erase(table.columns.begin() + dropped);
+
+						std::vector<std::string> keys;
+						for (std::vector<std::string>::const_iterator k = table.keys.begin() ; k != table.keys.end() ; ++k)
+						{
+							if (k->find(column) == std::string::npos)
+							{
+								keys.push_back(*k);
+							}
+						}
+						table.keys = keys;
+					}
+					break;
+
+				case 2:
+					table.columns[random.range(1, last)].second = "varchar(100) DEFAULT NULL";
+					break;
+
+				case 3:
+					{
+						const std::string& column = table.columns[random.range(1, last)].first;
+						addKey(table, "KEY `k2_" + column + "` (`" + column + "`)");
+					}
+					break;
+
+				case 4:
+					if (table.keys.size() > 1)
+					{
+						table.keys.pop_back();
+					}
+					break;
+
+				case 5:
+					if (last > 2)
+					{
+						const int from = random.range(1, last);
+						const Column column(table.columns[from]);
+						table.columns.erase(table.columns.begin() + from);
+						table.columns.insert(table.columns.begin() + random.range(1, last), column);
+					}
+					break;
+
+				case 6:
+					if (last > 1)
+					{
+						Column& column = table.columns[random.range(1, last)];
+						column.first = "ren_" + column.first;
+					}
+					break;
+			}
+		}
+
+		result.push_back(table);
+	}
+
+	const int created = random.range(0, 3);
+	for (int i = 0 ; i < created ; ++i)
+	{
+		Table table;
+		table.name = "new" + std::to_string(seed) + "_" + std::to_string(i);
+		table.columns.push_back(Column("id", "int(11) NOT NULL"));
+		table.columns.push_back(Column("v", "text"));
+		table.keys.push_back("PRIMARY KEY (`id`)");
+		result.insert(result.begin() + random.range(0, static_cast<int>(result.size())), table);
+	}
+
+	return result;
+}
+
+/* with "rows" insert statements per table, for the scanner to skip
+*/
+
+void
+dump(const std::vector<Table>& tables, const std::string& fname, int rows, std::uint64_t seed)
+{
+	std::ofstream out(fname.c_str());
+	if (!out.good())
+	{
+		throw std::runtime_error("cannot open file " + fname + " for writing.");
+	}
+
+	Random random(seed);
+
+	out << "-- MySQL dump 10.13\n/*!40101 SET NAMES utf8 */;\n\n";
+
+	for (std::vector<Table>::const_iterator it = tables.begin() ; it != tables.end() ; ++it)
+	{
+		out << "--\n-- Table structure for table `" << it->name << "`\n--\n\n"
+			<< "DROP TABLE IF EXISTS `" << it->name << "`;\n"
+			<< "/*!40101 SET @saved_cs_client     = @@character_set_client */;\n"
+			<< "CREATE TABLE `" << it->name << "` (\n";
+
+		for (std::size_t i = 0 ; i < it->columns.size() ; ++i)
+		{
+			out << ((i == 0) ? "" : ",\n") << "  `" << it->columns[i].first << "` " << it->columns[i].second;
+		}
+		for (std::vector<std::string>::const_iterator k = it->keys.begin() ; k != it->keys.end() ; ++k)
+		{
+			out << ",\n  " << *k;
+		}
+
+		out << "\n) ENGINE=InnoDB AUTO_INCREMENT=" << random.range(1, 1000) << " DEFAULT CHARSET=utf8;\n"
+			<< "/*!40101 SET character_set_client = @saved_cs_client */;\n\n"
+			<< "LOCK TABLES `" << it->name << "` WRITE;\n";
+
+		for (int r = 0 ; r < rows ; ++r)
+		{
+			out << "INSERT INTO `" << it->name << "` VALUES ";
+
+			const int values = random.range(1, 20);
+			for (int v = 0 ; v < values ; ++v)
+			{
+				std::string text;
+				for (int n = random.range(0, 3) ; n > 0 ; --n)
+				{
+					text += "crea";
+				}
+				text += "Cr\\nxCr\\nxCr\\nx";
+
+				out << ((v == 0) ? "" : ",") << "(" << v << ",'" << text << "','x;y(z)\\'')";
+			}
+
+			out << ";\n";
+		}
+
+		out << "UNLOCK TABLES;\n\n";
+	}
+
+	out.close();
+	if (!out.good())
+	{
+		throw std::runtime_error("error while writing " + fname);
+	}
+}
+
+unsigned int
+parseNumber(const std::string& option, const std::string& value)
+{
+	std::istringstream istr(value);
+	unsigned int number;
+
+	if (!(istr >> number) || !istr.eof())
+	{
+		throw std::runtime_error("Bad value \"" + value + "\" for option " + option);
+	}
+
+	return number;
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char* argv[])
+{
+	try
+	{
+		const std::string usage("usage: " + std::string(argv[0]) + " [--tables N] [--rows N] [--seed N] version1.sql version2.sql");
+
+		unsigned int tables = 20000, rows = 3, seed = 1;
+		int pstart = 1;
+
+		while (pstart < argc && std::string(argv[pstart]).compare(0, 2, "--") == 0)
+		{
+			const std::string option(argv[pstart++]);
+			if (pstart == argc)
+			{
+				throw std::runtime_error("Missing value for option " + option + "; " + usage);
+			}
+
+			if (option == "--tables")
+			{
+				tables = parseNumber(option, argv[pstart++]);
+			}
+			else if (option == "--rows")
+			{
+				rows = parseNumber(option, argv[pstart++]);
+			}
+			else if (option == "--seed")
+			{
+				seed = parseNumber(option, argv[pstart++]);
+			}
+			else
+			{
+				throw std::runtime_error("Unknown option: " + option);
+			}
+		}
+
+		if (argc - pstart != 2)
+		{
+			throw std::runtime_error("Wrong number of parameters; " + usage);
+		}
+
+		const std::vector<Table> version1(generate(tables, seed));
+		const std::vector<Table> version2(mutate(version1, seed + 1));
+
+		dump(version1, argv[pstart], rows, seed);
+		dump(version2, argv[pstart + 1], rows, seed + 7);
+	}
+	catch(std::exception &ex)
+	{
+		std::cerr << "Caught exception: " << ex.what() << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,28 @@
+#! /bin/sh
+# the upgrade script from version1.sql to version2.sql has to be expected.sql.
+# Besides the usual table and key changes, the column_types table holds columns
+# written differently that MySQL takes for the same (no statement may come out
+# for them) and columns that only look alike (each needs its modify)
+
+srcdir=${srcdir:-.}
+parser=${SQLFILEPARSER:-../src/sqlFileParser}
+
+work=golden.$$
+rm -rf "$work"
+mkdir "$work" || exit 1
+trap 'rm -rf "$work"' EXIT INT TERM
+
+if ! $parser "$srcdir/version1.sql" "$srcdir/version2.sql" > "$work/output.sql"
+then
+	echo "FAIL: $parser $srcdir/version1.sql $srcdir/version2.sql"
+	exit 1
+fi
+
+if ! cmp -s "$srcdir/expected.sql" "$work/output.sql"
+then
+	echo "FAIL: the output differs from $srcdir/expected.sql"
+	diff "$srcdir/expected.sql" "$work/output.sql"
+	exit 1
+fi
+
+exit 0
@@ -0,0 +1,46 @@
+#! /bin/sh
+# the upgrade script must not depend on --threads: in every mode, on the sample
+# dumps and on a generated pair, the output of --threads 2, 3 and 8 has to be
+# byte for byte the output of --threads 1
+
+srcdir=${srcdir:-.}
+parser=${SQLFILEPARSER:-../src/sqlFileParser}
+
+work=threads.$$
+rm -rf "$work"
+mkdir "$work" || exit 1
+trap 'rm -rf "$work"' EXIT INT TERM
+
+./gendump --tables 1000 --rows 1 "$work/generated1.sql" "$work/generated2.sql" || exit 1
+
+status=0
+
+for pair in "$srcdir/version1.sql $srcdir/version2.sql" "$work/generated1.sql $work/generated2.sql"
+do
+	for mode in "" "--lazy" "--format json" "--single-alter" "--detect-table-renames" "--online-ddl" \
+		"--single-alter --online-ddl --skip-column-moves" "--format json --online-ddl"
+	do
+		if ! $parser --threads 1 $mode $pair > "$work/serial.out"
+		then
+			echo "FAIL: $parser --threads 1 $mode $pair"
+			status=1
+			continue
+		fi
+
+		for threads in 2 3 8
+		do
+			if ! $parser --threads $threads $mode $pair > "$work/parallel.out"
+			then
+				echo "FAIL: $parser --threads $threads $mode $pair"
+				status=1
+			elif ! cmp -s "$work/serial.out" "$work/parallel.out"
+			then
+				echo "FAIL: --threads $threads $mode differs from --threads 1 on $pair"
+				diff "$work/serial.out" "$work/parallel.out" | head -20
+				status=1
+			fi
+		done
+	done
+done
+
+exit $status
@@ -0,0 +1,114 @@
+-- MySQL dump 10.13
+/*!40101 SET NAMES utf8mb4 */;
+
+DROP TABLE IF EXISTS `users`;
+CREATE TABLE `users` (
+  `id` int(11) NOT NULL AUTO_INCREMENT,
+  `email` varchar(320) NOT NULL,
+  `display_name` varchar(64) DEFAULT NULL,
+  `status` enum('new','active','banned') NOT NULL DEFAULT 'new',
+  `last_login` datetime DEFAULT NULL,
+  `created_at` datetime NOT NULL,
+  `modified_at` timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP,
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `u_email` (`email`),
+  KEY `idx_status_created` (`status`,`created_at`)
+) ENGINE=InnoDB AUTO_INCREMENT=97 DEFAULT CHARSET=utf8mb4;
+
+LOCK TABLES `users` WRITE;
+INSERT INTO `users` VALUES (1,'a@example.com','a;b','new',NULL,'2020-01-01 00:00:00','2020-01-01 00:00:00');
+UNLOCK TABLES;
+
+DROP TABLE IF EXISTS `orders`;
+CREATE TABLE `orders` (
+  `id` int(11) NOT NULL AUTO_INCREMENT,
+  `user_id` int(11) NOT NULL,
+  `shipped` tinyint(1) NOT NULL DEFAULT '0',
+  `total` decimal(12,2) NOT NULL,
+  `currency` char(3) NOT NULL DEFAULT 'EUR',
+  PRIMARY KEY (`id`),
+  KEY `fk_orders_user` (`user_id`),
+  CONSTRAINT `fk_orders_user` FOREIGN KEY (`user_id`) REFERENCES `users` (`id`) ON DELETE CASCADE
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
+
+DROP TABLE IF EXISTS `order_items`;
+CREATE TABLE `order_items` (
+  `order_id` int(11) NOT NULL,
+  `line` int(11) NOT NULL,
+  `sku` varchar(32) NOT NULL,
+  `qty` int(11) NOT NULL DEFAULT '1',
+  `price` decimal(10,2) NOT NULL,
+  `discount` decimal(10,2) DEFAULT NULL,
+  PRIMARY KEY (`order_id`,`line`),
+  KEY `idx_sku` (`sku`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
+
+DROP TABLE IF EXISTS `articles`;
+CREATE TABLE `articles` (
+  `id` bigint(20) unsigned NOT NULL AUTO_INCREMENT,
+  `title` varchar(200) NOT NULL,
+  `author` varchar(100) DEFAULT NULL,
+  `body` mediumtext NOT NULL,
+  PRIMARY KEY (`id`),
+  FULLTEXT KEY `ft_title_body` (`title`,`body`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
+
+DROP TABLE IF EXISTS `places`;
+CREATE TABLE `places` (
+  `id` int(11) NOT NULL,
+  `name` varchar(100) NOT NULL,
+  `location` point NOT NULL,
+  PRIMARY KEY (`id`),
+  SPATIAL KEY `sp_location` (`location`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
+
+DROP TABLE IF EXISTS `event_log`;
+CREATE TABLE `event_log` (
+  `id` bigint(20) NOT NULL AUTO_INCREMENT,
+  `actor` int(11) NOT NULL,
+  `action` varchar(50) NOT NULL,
+  `payload` json DEFAULT NULL,
+  `logged_at` datetime NOT NULL,
+  PRIMARY KEY (`id`),
+  KEY `idx_actor` (`actor`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
+
+DROP TABLE IF EXISTS `settings`;
+CREATE TABLE `settings` (
+  `name` varchar(64) NOT NULL,
+  `value` varchar(255) DEFAULT NULL,
+  PRIMARY KEY (`name`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
+
+DROP TABLE IF EXISTS `stats_daily`;
+CREATE TABLE `stats_daily` (
+  `day` date NOT NULL,
+  `hits` bigint(20) NOT NULL,
+  `visitors` int(11) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`day`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
+
+DROP TABLE IF EXISTS `labels`;
+CREATE TABLE `labels` (
+  `id` int(11) NOT NULL AUTO_INCREMENT,
+  `label` varchar(50) NOT NULL,
+  `color` varchar(7) DEFAULT NULL,
+  `weight` smallint(6) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `u_label` (`label`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
+
+DROP TABLE IF EXISTS `column_types`;
+CREATE TABLE `column_types` (
+  `id` int(11) NOT NULL,
+  `counter` int(11) NOT NULL DEFAULT 0,
+  `flag` tinyint(1) NOT NULL,
+  `amount` decimal(10,0) NOT NULL,
+  `code` varchar(10) CHARACTER SET utf8 DEFAULT NULL,
+  `label` varchar(20) DEFAULT NULL,
+  `title` varchar(20) CHARACTER SET utf8mb4 DEFAULT NULL,
+  `ratio` float(25) DEFAULT NULL,
+  `serial` int(8) unsigned zerofill NOT NULL,
+  `small` smallint(6) zerofill DEFAULT NULL,
+  PRIMARY KEY (`id`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;